@@ -0,0 +1,77 @@
+#ifndef SENTIMENTANALYSIS_ATOMICWEIGHTS_H
+#define SENTIMENTANALYSIS_ATOMICWEIGHTS_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "SparseVector.h"
+
+// Weight vector shared by Hogwild training threads
+// Every access is a relaxed atomic load or store with no locks and no read-modify-write, so on x86 it
+// compiles to plain moves. Concurrent updates of the same weight may overwrite each other; with sparse
+// bag-of-words rows such collisions are rare and SGD tolerates them.
+class AtomicWeights {
+private:
+    std::vector<std::atomic<double>> values;
+
+public:
+    explicit AtomicWeights(const std::vector<double> &initial) : values(initial.size()) {
+        for (size_t i = 0; i < initial.size(); ++i) {
+            values[i].store(initial[i], std::memory_order_relaxed);
+        }
+    }
+
+    // Dot product with a sparse vector
+    double dot(const SparseView &x) const {
+        double sum = 0.0;
+        for (size_t k = 0; k < x.nnz; ++k) {
+            sum += x.values[k] * values[x.indices[k]].load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    // w = decay * w + step * x on the nonzero entries of x only
+    void update(const SparseView &x, double decay, double step) {
+        for (size_t k = 0; k < x.nnz; ++k) {
+            std::atomic<double> &weight = values[x.indices[k]];
+            weight.store(decay * weight.load(std::memory_order_relaxed) + step * x.values[k], std::memory_order_relaxed);
+        }
+    }
+
+    // Copy the current values out, e.g. once all threads have finished
+    void copyTo(std::vector<double> &out) const {
+        out.resize(values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            out[i] = values[i].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+// Bias shared by Hogwild training threads
+// It sits alone on its cache line, so weight updates never invalidate it. Threads buffer their bias steps
+// locally and add them every PUBLISH_INTERVAL samples, so the line is touched a few times per shard
+// instead of twice per sample, and every thread still sees the others' steps within the epoch.
+class alignas(64) AtomicBias {
+private:
+    std::atomic<double> value;
+
+public:
+    static constexpr size_t PUBLISH_INTERVAL = 32;
+
+    explicit AtomicBias(double initial) : value(initial) {}
+
+    double load() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    // Add a buffered step; a compare-exchange loop, since publishes are rare and none should be lost
+    void add(double step) {
+        double current = value.load(std::memory_order_relaxed);
+        while (!value.compare_exchange_weak(current, current + step, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+
+#endif //SENTIMENTANALYSIS_ATOMICWEIGHTS_H
@@ -0,0 +1,15 @@
+#include "CsrMatrix.h"
+
+void CsrMatrix::addRow(const SparseVector &row, int label) {
+    indices.insert(indices.end(), row.indices.begin(), row.indices.end());
+    values.insert(values.end(), row.values.begin(), row.values.end());
+    rowOffsets.push_back(indices.size());
+    labels.push_back(label);
+}
+
+void CsrMatrix::reserve(size_t numRows, size_t numNonZeros) {
+    rowOffsets.reserve(numRows + 1);
+    labels.reserve(numRows);
+    indices.reserve(numNonZeros);
+    values.reserve(numNonZeros);
+}
@@ -0,0 +1,45 @@
+#ifndef SENTIMENTANALYSIS_CSRMATRIX_H
+#define SENTIMENTANALYSIS_CSRMATRIX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SparseVector.h"
+
+// Bag-of-words dataset in compressed sparse row form: one row per sample, one column per vocabulary feature
+// All rows live in three contiguous arrays, so a training epoch streams linearly through memory
+class CsrMatrix {
+private:
+    std::vector<size_t> rowOffsets{0}; // Row i spans [rowOffsets[i], rowOffsets[i + 1]) in indices/values
+    std::vector<uint32_t> indices;     // Feature ids, sorted and unique within each row
+    std::vector<double> values;        // Token counts
+    std::vector<int> labels;           // 0 - negative, 1 - positive
+    int cols = 0;
+
+public:
+    CsrMatrix() = default;
+    explicit CsrMatrix(int numCols) : cols(numCols) {}
+
+    void addRow(const SparseVector &row, int label);
+    void reserve(size_t numRows, size_t numNonZeros);
+
+    size_t numRows() const { return labels.size(); }
+    int numCols() const { return cols; }
+    size_t nnz() const { return indices.size(); }
+
+    size_t rowStart(size_t row) const { return rowOffsets[row]; }
+    size_t rowEnd(size_t row) const { return rowOffsets[row + 1]; }
+    int label(size_t row) const { return labels[row]; }
+
+    SparseView row(size_t i) const {
+        return {indices.data() + rowOffsets[i], values.data() + rowOffsets[i], rowOffsets[i + 1] - rowOffsets[i]};
+    }
+
+    const std::vector<uint32_t> &getIndices() const { return indices; }
+    const std::vector<double> &getValues() const { return values; }
+    const std::vector<int> &getLabels() const { return labels; }
+};
+
+
+#endif //SENTIMENTANALYSIS_CSRMATRIX_H
@@ -0,0 +1,86 @@
+#include "CsvReader.h"
+
+#include <cstring>
+
+// Function to read the next CSV record from the buffer
+// Handles quoted fields with embedded commas, escaped quotes and line breaks, and CRLF line endings
+bool CsvReader::next(std::vector<std::string_view> &fields) {
+    fields.clear();
+    if (position >= buffer.size()) {
+        return false;
+    }
+
+    const char *p = buffer.data() + position;
+    const char *end = buffer.data() + buffer.size();
+
+    while (true) {
+        if (p < end && *p == '"') {
+            // Quoted field: runs until a quote that is not followed by another quote
+            const char *start = ++p;
+            const char *fieldEnd = end;
+            while (p < end) {
+                const char *quote = static_cast<const char *>(std::memchr(p, '"', end - p));
+                if (quote == nullptr) {
+                    p = end; // Unterminated quote, take the rest of the buffer
+                    break;
+                }
+                if (quote + 1 < end && quote[1] == '"') {
+                    p = quote + 2; // Escaped quote
+                    continue;
+                }
+                fieldEnd = quote;
+                p = quote + 1;
+                break;
+            }
+            fields.emplace_back(start, fieldEnd - start);
+
+            // Skip anything between the closing quote and the next delimiter (e.g. '\r')
+            while (p < end && *p != ',' && *p != '\n') {
+                ++p;
+            }
+        } else {
+            const char *start = p;
+            while (p < end && *p != ',' && *p != '\n') {
+                ++p;
+            }
+            const char *fieldEnd = p;
+            if (fieldEnd > start && fieldEnd[-1] == '\r' && (p == end || *p == '\n')) {
+                --fieldEnd;
+            }
+            fields.emplace_back(start, fieldEnd - start);
+        }
+
+        if (p < end && *p == ',') {
+            ++p;
+            continue;
+        }
+        if (p < end) {
+            ++p; // Consume the line break
+        }
+        break;
+    }
+
+    position = p - buffer.data();
+    return true;
+}
+
+// Function to find record-aligned split points for parallel parsing
+// Walks the records with next() itself, so quotes are interpreted exactly as the parser does (only a quote at
+// the start of a field opens a quoted field) and a line break inside a quoted field is never used as a split point
+std::vector<size_t> CsvReader::splitRecords(std::string_view buffer, size_t parts) {
+    std::vector<size_t> boundaries{0};
+    CsvReader reader(buffer);
+    std::vector<std::string_view> fields;
+
+    for (size_t k = 1; k < parts && reader.offset() < buffer.size(); ++k) {
+        size_t target = buffer.size() / parts * k;
+        while (reader.offset() < target && reader.next(fields)) {
+        }
+        if (reader.offset() < buffer.size() && reader.offset() > boundaries.back()) {
+            boundaries.push_back(reader.offset());
+        }
+    }
+
+    boundaries.push_back(buffer.size());
+    return boundaries;
+}
@@ -0,0 +1,32 @@
+#ifndef SENTIMENTANALYSIS_CSVREADER_H
+#define SENTIMENTANALYSIS_CSVREADER_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// Zero-copy RFC 4180 record reader over an in-memory buffer (e.g. a MappedFile)
+// Fields are returned as views into the buffer, so they stay valid only as long as the buffer does.
+// Quoted fields are returned without their enclosing quotes; escaped quotes ("") inside them are
+// left as-is, since every consumer in this project strips punctuation from the text anyway.
+class CsvReader {
+private:
+    std::string_view buffer;
+    size_t position = 0;
+
+public:
+    explicit CsvReader(std::string_view buffer) : buffer(buffer) {}
+
+    // Reads the next record into fields (reusing its capacity); returns false at end of input
+    bool next(std::vector<std::string_view> &fields);
+
+    // Returns the offset just past the last record that was read
+    size_t offset() const { return position; }
+
+    // Splits the buffer into at most `parts` byte ranges that each start at a record boundary
+    // Returns the range start offsets followed by buffer.size(); quoted line breaks are never split
+    static std::vector<size_t> splitRecords(std::string_view buffer, size_t parts);
+};
+
+
+#endif //SENTIMENTANALYSIS_CSVREADER_H
@@ -1,9 +1,22 @@
 #include "DSText.h"
+#include "StringInterner.h"
 
-vector<string> DSText::getTokens() const {
+// Constructor that interns the given token strings
+DSText::DSText(const vector<string> &txt, int lbl) : tokens(StringInterner::global().intern(txt)), label(lbl) {}
+
+TokenView DSText::getTokens() const {
     return tokens;
 }
 
+vector<string> DSText::getTokenStrings() const {
+    vector<string> result;
+    result.reserve(tokens.size());
+    for (uint32_t id : tokens) {
+        result.push_back(StringInterner::global().str(id));
+    }
+    return result;
+}
+
 int DSText::getLabel() const {
     return label;
-}
\ No newline at end of file
+}
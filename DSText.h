@@ -2,6 +2,7 @@
 #define SENTIMENTANALYSIS_DSTEXT_H
 
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <stdexcept>
 #include <vector>
@@ -10,15 +11,39 @@
 using namespace std;
 
 
+// Read-only, non-owning view over a sequence of interned token ids
+class TokenView {
+private:
+    const uint32_t *first = nullptr;
+    size_t count = 0;
+
+public:
+    TokenView() = default;
+    TokenView(const uint32_t *data, size_t size) : first(data), count(size) {}
+    TokenView(const vector<uint32_t> &ids) : first(ids.data()), count(ids.size()) {}
+
+    const uint32_t *begin() const { return first; }
+    const uint32_t *end() const { return first + count; }
+    const uint32_t *data() const { return first; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    uint32_t operator[](size_t i) const { return first[i]; }
+};
+
+
 class DSText {
 private:
-    vector<string> tokens;
+    vector<uint32_t> tokens; // ids from StringInterner::global()
     int label; // 0 - negative, 1 - positive
 
 public:
-    DSText(vector<string> &txt, int lbl) : tokens(txt), label(lbl) {}
+    DSText(vector<uint32_t> ids, int lbl) : tokens(std::move(ids)), label(lbl) {}
+    DSText(const vector<string> &txt, int lbl);
+
+    TokenView getTokens() const;
 
-    vector<string> getTokens() const;
+    // Token strings, for debugging and display only
+    vector<string> getTokenStrings() const;
 
     int getLabel() const;
 };
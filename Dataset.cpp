@@ -1,4 +1,6 @@
 #include "Dataset.h"
+#include "TextPreprocessor.h"
+#include "Vocabulary.h"
 
 // Getter function to access the data stored in the Dataset object
 // Returns a reference to the vector containing DSText objects
@@ -9,23 +11,28 @@ vector<DSText> &Dataset::getData() {
 // Adds a new text sample to the dataset along with its corresponding label
 // The tokens are stored as a DSText object, which is then added to the data vector
 void Dataset::addTokens(vector<std::string> tokens, int label) {
-    data.push_back(DSText(tokens, label));
+    data.push_back(DSText(std::move(tokens), label));
 }
 
-// Creates a vocabulary from all tokens present in the dataset
-// The vocabulary is an unordered_map where each token is assigned a unique index
-std::unordered_map<std::string, int> Dataset::createVocabulary() {
-    std::unordered_map<std::string, int> vocabulary;
-    int index = 0;
+// Adds an already constructed text sample to the dataset
+void Dataset::addSample(DSText sample) {
+    data.push_back(std::move(sample));
+}
+
+// Converts the dataset into a CSR bag-of-words matrix over the given vocabulary
+// Each row holds the sorted feature ids of a sample with their counts; tokens outside the vocabulary are dropped
+CsrMatrix Dataset::toCsr(const Vocabulary &vocabulary) {
+    size_t totalTokens = 0;
+    for (const auto &sample : getData()) {
+        totalTokens += sample.getTokens().size();
+    }
+
+    CsrMatrix matrix(vocabulary.size());
+    matrix.reserve(getData().size(), totalTokens);
 
-    for (const auto& sample : getData()) {
-        for (const auto& token : sample.getTokens()) {
-            // If the token is not already in the vocabulary, add it with the next available index
-            if (vocabulary.find(token) == vocabulary.end()) {
-                vocabulary[token] = index++;
-            }
-        }
+    for (const auto &sample : getData()) {
+        matrix.addRow(TextPreprocessor::createSparseFeatureVector(sample.getTokens(), vocabulary), sample.getLabel());
     }
 
-    return vocabulary;
+    return matrix;
 }
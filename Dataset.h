@@ -2,12 +2,15 @@
 #define SENTIMENTANALYSIS_DATASET_H
 
 #include "DSText.h"
+#include "CsrMatrix.h"
 
 #include <iostream>
 #include <vector>
 #include <string>
 #include <unordered_map>
 
+class Vocabulary;
+
 
 class Dataset {
 private:
@@ -16,7 +19,8 @@ private:
 public:
     vector<DSText> &getData();
     void addTokens(vector<string> tokens, int label);
-    std::unordered_map<std::string, int> createVocabulary();
+    void addSample(DSText sample);
+    CsrMatrix toCsr(const Vocabulary &vocabulary);
 
 };
 
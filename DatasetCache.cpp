@@ -0,0 +1,153 @@
+#include "DatasetCache.h"
+#include "MappedFile.h"
+#include "StringInterner.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+const char CACHE_MAGIC[8] = {'S', 'A', 'D', 'S', 'C', 'A', 'C', 'H'};
+const uint32_t CACHE_VERSION = 1;
+
+// File layout: header, uint64 sampleOffsets[numSamples + 1], uint32 stringOffsets[numStrings + 1],
+// uint32 tokenIds[numTokens], uint8 labels[numSamples], char strings[stringBytes]
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numStrings;
+    uint64_t key;
+    uint64_t numSamples;
+    uint64_t numTokens;
+    uint64_t stringBytes;
+};
+
+}
+
+// Function to load a dataset from a cache file
+// Returns false (leaving the dataset untouched) if the file is missing, corrupt or built with a different key
+bool DatasetCache::load(const std::string &filename, uint64_t key, Dataset &dataset) {
+    MappedFile file;
+    if (!std::filesystem::exists(filename) || !file.open(filename) || file.size() < sizeof(CacheHeader)) {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION || header.key != key) {
+        return false;
+    }
+
+    size_t expectedSize = sizeof(CacheHeader)
+                          + (header.numSamples + 1) * sizeof(uint64_t)
+                          + (header.numStrings + 1) * sizeof(uint32_t)
+                          + header.numTokens * sizeof(uint32_t)
+                          + header.numSamples
+                          + header.stringBytes;
+    if (file.size() != expectedSize) {
+        return false;
+    }
+
+    const char *cursor = file.data() + sizeof(CacheHeader);
+    auto sampleOffsets = reinterpret_cast<const uint64_t *>(cursor);
+    cursor += (header.numSamples + 1) * sizeof(uint64_t);
+    auto stringOffsets = reinterpret_cast<const uint32_t *>(cursor);
+    cursor += (header.numStrings + 1) * sizeof(uint32_t);
+    auto tokenIds = reinterpret_cast<const uint32_t *>(cursor);
+    cursor += header.numTokens * sizeof(uint32_t);
+    auto labels = reinterpret_cast<const uint8_t *>(cursor);
+    cursor += header.numSamples;
+    const char *strings = cursor;
+
+    if (stringOffsets[header.numStrings] != header.stringBytes || sampleOffsets[header.numSamples] != header.numTokens) {
+        return false;
+    }
+
+    // Map the cache's own token table onto the process-wide interner once, then remap ids per sample
+    StringInterner &interner = StringInterner::global();
+    std::vector<uint32_t> table;
+    table.reserve(header.numStrings);
+    for (uint32_t i = 0; i < header.numStrings; ++i) {
+        if (stringOffsets[i] > stringOffsets[i + 1]) {
+            return false;
+        }
+        table.push_back(interner.intern(std::string_view(strings + stringOffsets[i], stringOffsets[i + 1] - stringOffsets[i])));
+    }
+
+    Dataset loaded;
+    for (uint64_t i = 0; i < header.numSamples; ++i) {
+        if (sampleOffsets[i] > sampleOffsets[i + 1] || sampleOffsets[i + 1] > header.numTokens) {
+            return false;
+        }
+        std::vector<uint32_t> tokens;
+        tokens.reserve(sampleOffsets[i + 1] - sampleOffsets[i]);
+        for (uint64_t t = sampleOffsets[i]; t < sampleOffsets[i + 1]; ++t) {
+            if (tokenIds[t] >= header.numStrings) {
+                return false;
+            }
+            tokens.push_back(table[tokenIds[t]]);
+        }
+        loaded.addSample(DSText(std::move(tokens), labels[i]));
+    }
+
+    for (auto &sample : loaded.getData()) {
+        dataset.addSample(std::move(sample));
+    }
+    return true;
+}
+
+// Function to write a dataset to a cache file
+// Tokens are stored once in a string table and referenced by id from each sample
+bool DatasetCache::save(const std::string &filename, uint64_t key, Dataset &dataset) {
+    const StringInterner &interner = StringInterner::global();
+    std::vector<uint32_t> localIds(interner.size(), UINT32_MAX);
+    std::vector<const std::string *> table;
+    std::vector<uint64_t> sampleOffsets{0};
+    std::vector<uint32_t> tokenIds;
+    std::vector<uint8_t> labels;
+
+    // Renumber interned ids densely so the cache only stores the tokens this dataset uses
+    for (const auto &sample : dataset.getData()) {
+        for (uint32_t token : sample.getTokens()) {
+            if (localIds[token] == UINT32_MAX) {
+                localIds[token] = static_cast<uint32_t>(table.size());
+                table.push_back(&interner.str(token));
+            }
+            tokenIds.push_back(localIds[token]);
+        }
+        sampleOffsets.push_back(tokenIds.size());
+        labels.push_back(static_cast<uint8_t>(sample.getLabel()));
+    }
+
+    std::vector<uint32_t> stringOffsets{0};
+    for (const auto *token : table) {
+        stringOffsets.push_back(stringOffsets.back() + static_cast<uint32_t>(token->size()));
+    }
+
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.numStrings = static_cast<uint32_t>(table.size());
+    header.key = key;
+    header.numSamples = labels.size();
+    header.numTokens = tokenIds.size();
+    header.stringBytes = stringOffsets.back();
+
+    std::ofstream outFile(filename, std::ios::out | std::ios::binary);
+    if (!outFile.is_open()) {
+        std::cerr << "Error opening file for saving dataset cache: " << filename << std::endl;
+        return false;
+    }
+
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    outFile.write(reinterpret_cast<const char *>(sampleOffsets.data()), sampleOffsets.size() * sizeof(uint64_t));
+    outFile.write(reinterpret_cast<const char *>(stringOffsets.data()), stringOffsets.size() * sizeof(uint32_t));
+    outFile.write(reinterpret_cast<const char *>(tokenIds.data()), tokenIds.size() * sizeof(uint32_t));
+    outFile.write(reinterpret_cast<const char *>(labels.data()), labels.size());
+    for (const auto *token : table) {
+        outFile.write(token->data(), token->size());
+    }
+
+    return outFile.good();
+}
@@ -0,0 +1,19 @@
+#ifndef SENTIMENTANALYSIS_DATASETCACHE_H
+#define SENTIMENTANALYSIS_DATASETCACHE_H
+
+#include "Dataset.h"
+
+#include <cstdint>
+#include <string>
+
+// Binary cache of a preprocessed Dataset (token table, per-sample token ids and labels)
+// A cache is only used when its key matches, so callers fold everything that affects
+// preprocessing (source file, stopwords, pipeline version, sentence limit) into the key
+class DatasetCache {
+public:
+    static bool load(const std::string &filename, uint64_t key, Dataset &dataset);
+    static bool save(const std::string &filename, uint64_t key, Dataset &dataset);
+};
+
+
+#endif //SENTIMENTANALYSIS_DATASETCACHE_H
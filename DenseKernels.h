@@ -0,0 +1,171 @@
+#ifndef SENTIMENTANALYSIS_DENSEKERNELS_H
+#define SENTIMENTANALYSIS_DENSEKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "SparseVector.h"
+
+// Dense vector and matrix kernels used by the neural network
+// AVX-512 or AVX2 + FMA versions are compiled in when the target supports them, with a scalar fallback otherwise
+
+// Alignment of parameter buffers: one cache line, which is also the width of an AVX-512 register
+constexpr size_t KERNEL_ALIGNMENT = 64;
+
+// Standard allocator returning KERNEL_ALIGNMENT aligned storage, so vectors can be used as parameter buffers
+template <typename T>
+struct AlignedAllocator {
+    using value_type = T;
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(KERNEL_ALIGNMENT)));
+    }
+    void deallocate(T *p, size_t) {
+        ::operator delete(p, std::align_val_t(KERNEL_ALIGNMENT));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U> &) const { return false; }
+};
+
+// Vector of doubles in KERNEL_ALIGNMENT aligned storage
+using AlignedVector = std::vector<double, AlignedAllocator<double>>;
+
+// Number of doubles to reserve for n values so that the next section starts on an aligned boundary
+inline size_t alignedCount(size_t n) {
+    const size_t perLine = KERNEL_ALIGNMENT / sizeof(double);
+    return (n + perLine - 1) / perLine * perLine;
+}
+
+// Strided view of a dense matrix inside a larger buffer
+// The same memory can be viewed row-major (rows x cols) or column-major, which is its transpose
+struct MatrixView {
+    double *data = nullptr;
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t rowStride = 0;
+    size_t colStride = 0;
+
+    static MatrixView rowMajor(double *data, size_t rows, size_t cols) { return {data, rows, cols, cols, 1}; }
+    static MatrixView colMajor(double *data, size_t rows, size_t cols) { return {data, rows, cols, 1, rows}; }
+
+    double &operator()(size_t r, size_t c) const { return data[r * rowStride + c * colStride]; }
+    MatrixView transposed() const { return {data, cols, rows, colStride, rowStride}; }
+    // Start of row r; the row is contiguous only in a row-major view
+    double *row(size_t r) const { return data + r * rowStride; }
+};
+
+// Dot product of two dense vectors of length n
+inline double dot(size_t n, const double *x, const double *y) {
+    size_t i = 0;
+    double sum = 0.0;
+#if defined(__AVX512F__)
+    __m512d acc = _mm512_setzero_pd();
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), acc);
+    }
+    if (i < n) {
+        __mmask8 mask = static_cast<__mmask8>((1u << (n - i)) - 1);
+        acc = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i), acc);
+        i = n;
+    }
+    // The zero-masked extracts avoid the undefined source operand of _mm512_extractf64x4_pd, which GCC warns about
+    __m256d quarter = _mm256_add_pd(_mm512_maskz_extractf64x4_pd(0xF, acc, 0), _mm512_maskz_extractf64x4_pd(0xF, acc, 1));
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(quarter), _mm256_extractf128_pd(quarter, 1));
+    sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+#elif defined(__AVX2__) && defined(__FMA__)
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), acc1);
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), acc0);
+    }
+    __m256d acc = _mm256_add_pd(acc0, acc1);
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+#endif
+    for (; i < n; ++i) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+// y += alpha * x for dense vectors of length n
+inline void axpy(size_t n, double alpha, const double *x, double *y) {
+    size_t i = 0;
+#if defined(__AVX512F__)
+    __m512d a = _mm512_set1_pd(alpha);
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(y + i, _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    }
+    if (i < n) {
+        __mmask8 mask = static_cast<__mmask8>((1u << (n - i)) - 1);
+        __m512d result = _mm512_fmadd_pd(a, _mm512_maskz_loadu_pd(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i));
+        _mm512_mask_storeu_pd(y + i, mask, result);
+        i = n;
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    __m256d a = _mm256_set1_pd(alpha);
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+#endif
+    for (; i < n; ++i) {
+        y[i] += alpha * x[i];
+    }
+}
+
+// Matrix-vector product y += A x for a row-major A
+inline void gemv(const MatrixView &a, const double *x, double *y) {
+    for (size_t r = 0; r < a.rows; ++r) {
+        y[r] += dot(a.cols, a.row(r), x);
+    }
+}
+
+// Matrix-vector product y += A^T x for a row-major A, accumulated one row of A at a time
+inline void gemvTransposed(const MatrixView &a, const double *x, double *y) {
+    for (size_t r = 0; r < a.rows; ++r) {
+        axpy(a.cols, x[r], a.row(r), y);
+    }
+}
+
+// Rank-1 update A += alpha * x y^T for a row-major A
+inline void ger(const MatrixView &a, double alpha, const double *x, const double *y) {
+    for (size_t r = 0; r < a.rows; ++r) {
+        axpy(a.cols, alpha * x[r], y, a.row(r));
+    }
+}
+
+// Matrix-vector product y += A^T x for a row-major A and a sparse x
+// Only the rows of A selected by x are read, which is the embedding-bag sum of those rows
+inline void gemvSparse(const MatrixView &a, const SparseView &x, double *y) {
+    for (size_t k = 0; k < x.nnz; ++k) {
+        axpy(a.cols, x.values[k], a.row(x.indices[k]), y);
+    }
+}
+
+// Rank-1 update A += alpha * x y^T for a row-major A and a sparse x
+// Only the rows of A selected by x are written
+inline void gerSparse(const MatrixView &a, double alpha, const SparseView &x, const double *y) {
+    for (size_t k = 0; k < x.nnz; ++k) {
+        axpy(a.cols, alpha * x.values[k], y, a.row(x.indices[k]));
+    }
+}
+
+
+#endif //SENTIMENTANALYSIS_DENSEKERNELS_H
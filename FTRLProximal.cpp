@@ -0,0 +1,186 @@
+#include "FTRLProximal.h"
+#include "TextPreprocessor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+// Contents of SECTION_META in a saved model
+struct ModelMeta {
+    int32_t numFeatures;
+    uint32_t numNonZero;
+    double bias;
+};
+
+}
+
+// Constructor: all state starts at zero, so every weight starts at zero
+FTRLProximal::FTRLProximal(int numFeatures, double alpha, double beta, double l1, double l2)
+        : z(numFeatures + 1, 0.0), n(numFeatures + 1, 0.0), weights(numFeatures, 0.0), bias(0.0),
+          numFeatures(numFeatures), alpha(alpha), beta(beta), l1(l1), l2(l2) {}
+
+double FTRLProximal::sigmoid(double x) const {
+    return 1.0 / (1.0 + std::exp(-x));
+}
+
+// Closed-form weight of one coordinate from its FTRL state
+// Zero while |z| is within the L1 threshold, otherwise the shrunk, per-coordinate scaled solution
+double FTRLProximal::weight(size_t index, double l1Strength) const {
+    if (std::fabs(z[index]) <= l1Strength) {
+        return 0.0;
+    }
+    double sign = z[index] < 0.0 ? -1.0 : 1.0;
+    return -(z[index] - sign * l1Strength) / ((beta + std::sqrt(n[index])) / alpha + l2);
+}
+
+// Compute every weight and the bias from the current state
+void FTRLProximal::materializeWeights() {
+    for (int i = 0; i < numFeatures; ++i) {
+        weights[i] = weight(i, l1);
+    }
+    bias = weight(numFeatures, 0.0); // The bias is not L1 regularized
+}
+
+// Train online over the rows of the dataset
+// Each sample computes the weights of its own features lazily from z and n, so a step costs O(nnz)
+void FTRLProximal::train(const CsrMatrix& dataset, const CsrMatrix& devDataset, int epochs, bool verbose) {
+    std::vector<double> sampleWeights;
+
+    for (int epoch = 0; epoch < epochs; ++epoch) {
+        double totalLoss = 0.0;
+
+        for (size_t i = 0; i < dataset.numRows(); ++i) {
+            SparseView features = dataset.row(i);
+            int label = dataset.label(i);
+
+            // Weights of the active features, and the prediction
+            sampleWeights.resize(features.nnz);
+            double biasWeight = weight(numFeatures, 0.0);
+            double margin = biasWeight;
+            for (size_t k = 0; k < features.nnz; ++k) {
+                sampleWeights[k] = weight(features.indices[k], l1);
+                margin += sampleWeights[k] * features.values[k];
+            }
+            double prediction = std::max(1e-10, std::min(1.0 - 1e-10, sigmoid(margin)));
+            totalLoss += -label * std::log(prediction) - (1 - label) * std::log(1 - prediction);
+
+            // Update the per-coordinate state with the log-loss gradient
+            double residual = prediction - label;
+            for (size_t k = 0; k < features.nnz; ++k) {
+                uint32_t feature = features.indices[k];
+                double gradient = residual * features.values[k];
+                double sigma = (std::sqrt(n[feature] + gradient * gradient) - std::sqrt(n[feature])) / alpha;
+                z[feature] += gradient - sigma * sampleWeights[k];
+                n[feature] += gradient * gradient;
+            }
+            double sigma = (std::sqrt(n[numFeatures] + residual * residual) - std::sqrt(n[numFeatures])) / alpha;
+            z[numFeatures] += residual - sigma * biasWeight;
+            n[numFeatures] += residual * residual;
+        }
+
+        materializeWeights();
+        if (verbose) {
+            std::cout << "\nEpoch " << epoch + 1 << ", Loss: " << totalLoss << std::endl;
+            double accuracy = evaluate(devDataset);
+            std::cout << "Validation Accuracy: " << accuracy << "%" << std::endl;
+            std::cout << "Nonzero weights: " << getNumNonZero() << " of " << numFeatures << std::endl;
+        }
+    }
+}
+
+// Predict the label for a single sample
+int FTRLProximal::predict(TokenView tokens, const Vocabulary& vocabulary) {
+    auto featureVector = TextPreprocessor::createSparseFeatureVector(tokens, vocabulary);
+    return dot(featureVector, weights) + bias >= 0.0 ? 1 : 0;
+}
+
+// Evaluate the accuracy of the model on a validation dataset
+double FTRLProximal::evaluate(const CsrMatrix& dataset) {
+    int correctPredictions = 0;
+
+    for (size_t i = 0; i < dataset.numRows(); ++i) {
+        int predictedLabel = dot(dataset.row(i), weights) + bias >= 0.0 ? 1 : 0;
+        if (predictedLabel == dataset.label(i)) {
+            correctPredictions++;
+        }
+    }
+
+    return 100.0 * correctPredictions / dataset.numRows();
+}
+
+size_t FTRLProximal::getNumNonZero() const {
+    return std::count_if(weights.begin(), weights.end(), [](double weight) { return weight != 0.0; });
+}
+
+// Save the model to a binary file
+void FTRLProximal::saveWeights(const std::string& filename) const {
+    if (modelWriter().write(filename)) {
+        std::cout << "Saved " << getNumNonZero() << " nonzero weights to " << filename << std::endl;
+    }
+}
+
+// Load the model from a binary file saved with the same number of features
+// Only the weights are restored; training after a load starts from fresh FTRL state
+bool FTRLProximal::loadWeights(const std::string& filename, bool verifyChecksums) {
+    ModelFile file;
+    return file.open(filename, ModelType::FTRLProximal, verifyChecksums) && readModelFile(file, numFeatures);
+}
+
+// Save the model together with its vocabulary, so it can be used without the training data
+void FTRLProximal::saveBundle(const std::string& filename, const Vocabulary& vocabulary, uint64_t stopwordsHash) const {
+    ModelBundle::save(filename, modelWriter(), vocabulary, stopwordsHash);
+}
+
+// Load a bundle saved by saveBundle; the model is resized to the number of features in the bundle
+bool FTRLProximal::loadBundle(const std::string& filename, uint64_t stopwordsHash, Vocabulary& vocabulary, bool verifyChecksums) {
+    return ModelBundle::load(filename, ModelType::FTRLProximal, stopwordsHash, vocabulary, verifyChecksums,
+                             [this](ModelFile&& file, int expectedFeatures) { return readModelFile(file, expectedFeatures); });
+}
+
+// Collect the sections of a saved model: numFeatures and the bias, then the ids and values of the nonzero weights
+ModelFileWriter FTRLProximal::modelWriter() const {
+    std::vector<uint32_t> indices;
+    std::vector<double> values;
+    for (int i = 0; i < numFeatures; ++i) {
+        if (weights[i] != 0.0) {
+            indices.push_back(i);
+            values.push_back(weights[i]);
+        }
+    }
+
+    ModelFileWriter writer(ModelType::FTRLProximal);
+    writer.addValue(SECTION_META, ModelMeta{numFeatures, static_cast<uint32_t>(indices.size()), bias});
+    writer.addOwned(SECTION_INDICES, std::string(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint32_t)));
+    writer.addOwned(SECTION_WEIGHTS, std::string(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double)));
+    return writer;
+}
+
+// Scatter the nonzero weights of a model file into the dense weights, checking every feature id
+// The model is resized to expectedFeatures, which must match the file, and is untouched on failure
+bool FTRLProximal::readModelFile(const ModelFile& file, int expectedFeatures) {
+    ModelMeta meta{};
+    const uint32_t* indices = nullptr;
+    const double* values = nullptr;
+    if (file.value(SECTION_META, meta) && meta.numFeatures == expectedFeatures && meta.numNonZero <= static_cast<uint32_t>(meta.numFeatures)) {
+        indices = file.array<uint32_t>(SECTION_INDICES, meta.numNonZero);
+        values = file.array<double>(SECTION_WEIGHTS, meta.numNonZero);
+    }
+    bool valid = indices != nullptr && values != nullptr
+                 && std::all_of(indices, indices + meta.numNonZero, [&](uint32_t id) { return id < static_cast<uint32_t>(meta.numFeatures); });
+    if (!valid) {
+        std::cerr << "Model parameters do not match: " << file.name() << std::endl;
+        return false;
+    }
+
+    numFeatures = meta.numFeatures;
+    bias = meta.bias;
+    z.assign(numFeatures + 1, 0.0);
+    n.assign(numFeatures + 1, 0.0);
+    weights.assign(numFeatures, 0.0);
+    for (uint32_t k = 0; k < meta.numNonZero; ++k) {
+        weights[indices[k]] = values[k];
+    }
+    return true;
+}
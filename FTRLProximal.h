@@ -0,0 +1,57 @@
+#ifndef SENTIMENTANALYSIS_FTRLPROXIMAL_H
+#define SENTIMENTANALYSIS_FTRLPROXIMAL_H
+
+#include "Dataset.h"
+#include "Vocabulary.h"
+#include "ModelBundle.h"
+
+#include <string>
+#include <vector>
+
+// Logistic regression trained online with FTRL-Proximal (McMahan et al., "Ad Click Prediction")
+// Every feature keeps its own adaptive learning rate, and the L1 term sets a weight exactly to zero
+// until the feature's accumulated gradient outweighs it, so most of the vocabulary ends up unused.
+// Only the nonzero weights are saved.
+class FTRLProximal {
+private:
+    std::vector<double> z;       // Per-feature accumulated adjusted gradient, last slot for the bias
+    std::vector<double> n;       // Per-feature accumulated squared gradient, last slot for the bias
+    std::vector<double> weights; // Weights materialized from z and n after training or loading
+    double bias;
+    int numFeatures;
+
+    double alpha;  // Learning rate scale
+    double beta;   // Learning rate smoothing
+    double l1;     // L1 regularization strength, drives weights to zero
+    double l2;     // L2 regularization strength
+
+    double sigmoid(double x) const;
+    double weight(size_t index, double l1Strength) const;
+    void materializeWeights();
+    ModelFileWriter modelWriter() const;
+    bool readModelFile(const ModelFile& file, int expectedFeatures);
+
+public:
+    explicit FTRLProximal(int numFeatures, double alpha = 0.1, double beta = 1.0, double l1 = 1.0, double l2 = 1.0);
+
+    // One pass per epoch over the rows in order, updating only the features of each sample
+    void train(const CsrMatrix& dataset, const CsrMatrix& devDataset, int epochs, bool verbose = true);
+    int predict(TokenView tokens, const Vocabulary& vocabulary);
+    double evaluate(const CsrMatrix& dataset);
+
+    // Functions for saving and loading the nonzero weights
+    void saveWeights(const std::string& filename) const;
+    // The sparse weights are scattered into dense storage, so loading copies O(nonzero weights)
+    bool loadWeights(const std::string& filename, bool verifyChecksums = true);
+
+    // Save or load a self-contained bundle with the vocabulary the weights are indexed by
+    void saveBundle(const std::string& filename, const Vocabulary& vocabulary, uint64_t stopwordsHash) const;
+    bool loadBundle(const std::string& filename, uint64_t stopwordsHash, Vocabulary& vocabulary, bool verifyChecksums = true);
+
+    // Getters for validation purposes
+    int getNumFeatures() const { return numFeatures; }
+    size_t getNumNonZero() const;
+};
+
+
+#endif //SENTIMENTANALYSIS_FTRLPROXIMAL_H
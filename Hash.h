@@ -0,0 +1,50 @@
+#ifndef SENTIMENTANALYSIS_HASH_H
+#define SENTIMENTANALYSIS_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Fast non-cryptographic 64-bit hash used to fingerprint input files and cached artifacts
+// Four independent lanes consume 32 bytes per round, so large files hash at memory speed
+inline uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0) {
+    const uint64_t prime = 0x9E3779B185EBCA87ULL;
+    const auto *p = static_cast<const unsigned char *>(data);
+    uint64_t lanes[4] = {seed ^ 0x243F6A8885A308D3ULL, seed ^ 0x13198A2E03707344ULL,
+                         seed ^ 0xA4093822299F31D0ULL, seed ^ 0x082EFA98EC4E6C89ULL};
+
+    while (size >= 32) {
+        for (auto &lane : lanes) {
+            uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            lane = (lane ^ word) * prime;
+            lane ^= lane >> 31;
+            p += sizeof(word);
+        }
+        size -= 32;
+    }
+
+    uint64_t hash = size;
+    for (uint64_t lane : lanes) {
+        hash = (hash ^ lane) * prime;
+        hash ^= hash >> 29;
+    }
+
+    // FNV-1a over the remaining tail bytes
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ p[i]) * 0x100000001B3ULL;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Mixes a value into an existing hash
+inline uint64_t hashCombine(uint64_t hash, uint64_t value) {
+    return hashBytes(&value, sizeof(value), hash);
+}
+
+
+#endif //SENTIMENTANALYSIS_HASH_H
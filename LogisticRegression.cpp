@@ -3,6 +3,8 @@
 #include <numeric>
 #include <algorithm>
 #include <iostream>
+#include <chrono>
+#include <memory>
 
 // Constructor to initialize the LogisticRegression object
 // Initializes weights to zeros and bias to 0.0
@@ -11,21 +13,6 @@ LogisticRegression::LogisticRegression(int numFeatures)
     weights = std::vector<double>(numFeatures, 0.0);
 }
 
-// Function to create a feature vector using Bag of Words
-// Converts a list of tokens into a fixed-size vector based on the vocabulary
-std::vector<double> LogisticRegression::createFeatureVectorBoW(const std::vector<std::string>& tokens, const std::unordered_map<std::string, int>& vocabulary) {
-    std::vector<double> featureVector(vocabulary.size(), 0.0);
-
-    // Increment the position in the vector corresponding to each token in the vocabulary
-    for (const auto& token : tokens) {
-        if (vocabulary.find(token) != vocabulary.end()) {
-            featureVector[vocabulary.at(token)] += 1.0;
-        }
-    }
-
-    return featureVector;
-}
-
 // Sigmoid function to map predictions to probabilities
 // Converts the linear combination of features into a probability between 0 and 1
 double LogisticRegression::sigmoid(double z) {
@@ -38,36 +25,69 @@ double LogisticRegression::clip(double value, double epsilon) {
     return std::max(epsilon, std::min(1 - epsilon, value));
 }
 
-// Function to update weights and bias using gradient descent
-// Applies the computed gradients to adjust the model parameters
-void LogisticRegression::updateWeights(const std::vector<double>& features, double error, double gradient, double learningRate) {
-    for (size_t i = 0; i < weights.size(); ++i) {
-        weights[i] += learningRate * error * gradient * features[i];
+// Function to compute the linear combination of weights and a sparse feature vector plus the bias
+// Only the nonzero features contribute, so this costs O(nnz) instead of O(vocabulary)
+double LogisticRegression::linearCombination(const SparseView& features) const {
+    return weightScale * dot(features, weightValues()) + bias;
+}
+
+// Function to update weights and bias using gradient descent with L2 regularization
+// The L2 shrink of every weight is a single multiply of weightScale, and only the sample's
+// nonzero features receive the gradient step, so an update costs O(nnz) instead of O(vocabulary)
+void LogisticRegression::updateWeights(const SparseView& features, double error, double gradient, double learningRate, double regularizationParam) {
+    weightScale *= 1.0 - learningRate * regularizationParam;
+    axpy(learningRate * error * gradient / weightScale, features, weights);
+    bias += learningRate * error * gradient; // The bias is not regularized
+
+    // Fold the scale back into the weights before it underflows
+    if (weightScale < 1e-9) {
+        foldWeightScale();
+    }
+}
+
+// Function to update weights and bias through the optimizer
+// Only the sample's nonzero features and the bias are updated; their L2 gradient is added here, so
+// features absent from a sample are not decayed on that step
+void LogisticRegression::updateWeightsAdaptive(const SparseView& features, double error, double gradient, double learningRate, double regularizationParam) {
+    double outputGradient = -error * gradient;
+    optimizer->step();
+    for (size_t k = 0; k < features.nnz; ++k) {
+        uint32_t feature = features.indices[k];
+        double featureGradient = outputGradient * features.values[k] + regularizationParam * weights[feature];
+        optimizer->update(feature, featureGradient, learningRate, weights[feature]);
+    }
+    optimizer->update(weights.size(), outputGradient, learningRate, bias);
+}
+
+// Function to multiply the pending scale factor into the stored weights
+void LogisticRegression::foldWeightScale() {
+    if (weightScale != 1.0) {
+        for (double& weight : weights) {
+            weight *= weightScale;
+        }
+        weightScale = 1.0;
     }
-    bias += learningRate * error * gradient;
 }
 
 // Function to predict the label for a single sample
 // Uses the sigmoid function to compute the probability and returns the binary prediction
-int LogisticRegression::predict(const std::vector<std::string>& tokens, const std::unordered_map<std::string, int>& vocabulary) {
-    auto featureVector = createFeatureVectorBoW(tokens, vocabulary);
-    double linearCombination = std::inner_product(featureVector.begin(), featureVector.end(), weights.begin(), 0.0) + bias;
-    double prediction = sigmoid(linearCombination);
+int LogisticRegression::predict(TokenView tokens, const Vocabulary& vocabulary) {
+    auto featureVector = TextPreprocessor::createSparseFeatureVector(tokens, vocabulary);
+    double prediction = sigmoid(linearCombination(featureVector));
 
     return prediction >= 0.5 ? 1 : 0;
 }
 
 // Function to evaluate the accuracy of the model on a validation dataset
 // Compares predicted labels with true labels and calculates accuracy
-double LogisticRegression::evaluate(Dataset& dataset, const std::unordered_map<std::string, int>& vocabulary) {
+double LogisticRegression::evaluate(const CsrMatrix& dataset) {
     int correctPredictions = 0;
     int totalPredictions = 0;
 
-    for (const auto &sample : dataset.getData()) {
-        auto tokens = sample.getTokens();
-        int trueLabel = sample.getLabel();
+    for (size_t i = 0; i < dataset.numRows(); ++i) {
+        int trueLabel = dataset.label(i);
 
-        int predictedLabel = predict(tokens, vocabulary);
+        int predictedLabel = sigmoid(linearCombination(dataset.row(i))) >= 0.5 ? 1 : 0;
 
         if (predictedLabel == trueLabel) {
             correctPredictions++;
@@ -79,106 +99,383 @@ double LogisticRegression::evaluate(Dataset& dataset, const std::unordered_map<s
     return 100.0 * correctPredictions / totalPredictions;
 }
 
+// Function to run one Hogwild epoch: every thread takes a contiguous shard of the rows and applies sparse
+// SGD steps to the shared weights without locks. L2 decay is applied only to the features of each sample,
+// because a shared lazy scale factor would be written by every update and serialize the threads.
+// Bias steps are buffered per thread and published in batches (see AtomicBias).
+// Returns the total log-loss of the epoch.
+double LogisticRegression::trainEpochHogwild(const CsrMatrix& dataset, ThreadPool& pool, AtomicWeights& sharedWeights, AtomicBias& sharedBias,
+                                             double learningRate, double regularizationParam) {
+    int numShards = pool.size();
+    std::vector<double> shardLoss(numShards, 0.0);
+    double decay = 1.0 - learningRate * regularizationParam;
+
+    pool.run(numShards, [&](int shard) {
+        size_t begin = dataset.numRows() * shard / numShards;
+        size_t end = dataset.numRows() * (shard + 1) / numShards;
+        double loss = 0.0;
+        double biasBase = sharedBias.load();
+        double biasStep = 0.0; // Not yet published to sharedBias
+
+        for (size_t i = begin; i < end; ++i) {
+            SparseView features = dataset.row(i);
+            int label = dataset.label(i);
+
+            double prediction = clip(sigmoid(sharedWeights.dot(features) + biasBase + biasStep));
+            double error = label - prediction;
+            loss += -label * std::log(prediction) - (1 - label) * std::log(1 - prediction);
+
+            double step = learningRate * error * prediction * (1 - prediction);
+            sharedWeights.update(features, decay, step);
+            biasStep += step;
+            if ((i - begin + 1) % AtomicBias::PUBLISH_INTERVAL == 0) {
+                sharedBias.add(biasStep);
+                biasStep = 0.0;
+                biasBase = sharedBias.load();
+            }
+        }
+        sharedBias.add(biasStep);
+        shardLoss[shard] = loss;
+    });
+
+    return std::accumulate(shardLoss.begin(), shardLoss.end(), 0.0);
+}
+
 // Function to train the logistic regression model
-// Iteratively adjusts weights and bias using gradient descent, with an optional verbose output
-void LogisticRegression::train(Dataset& dataset, const std::unordered_map<std::string, int>& vocabulary, Dataset& devDataset, double learningRate, int epochs, bool verbose) {
+// Iteratively adjusts weights and bias using sparse stochastic gradient descent with lazy L2 regularization,
+// with an optional verbose output. An epoch costs O(total nnz) regardless of the vocabulary size.
+// With more than one thread the epochs run in Hogwild mode instead.
+void LogisticRegression::train(const CsrMatrix& dataset, const CsrMatrix& devDataset, double learningRate, int epochs, double regularizationParam, bool verbose) {
+    if (learningRate * regularizationParam >= 1.0) {
+        std::cerr << "learningRate * regularizationParam must be below 1, got " << learningRate * regularizationParam << std::endl;
+        return;
+    }
+
+    mappedWeights.detach(weights);
+    foldWeightScale();
+    if (optimizer) {
+        optimizer->reset(weights.size() + 1); // One slot per feature plus the bias
+    }
+    std::unique_ptr<ThreadPool> pool;
+    std::unique_ptr<AtomicWeights> sharedWeights;
+    AtomicBias sharedBias(bias);
+    if (numThreads > 1 && optimizer) {
+        std::cerr << "Adaptive optimizers train on a single thread; ignoring the thread count of " << numThreads << std::endl;
+    } else if (numThreads > 1) {
+        pool = std::make_unique<ThreadPool>(numThreads);
+        sharedWeights = std::make_unique<AtomicWeights>(weights);
+    }
+    double trainingSeconds = 0.0;
+
     for (int epoch = 0; epoch < epochs; ++epoch) {
         double totalLoss = 0.0;
+        auto start = std::chrono::steady_clock::now();
+
+        if (pool) {
+            totalLoss = trainEpochHogwild(dataset, *pool, *sharedWeights, sharedBias, learningRate, regularizationParam);
+        } else {
+            for (size_t i = 0; i < dataset.numRows(); ++i) {
+                int label = dataset.label(i); // Assume labels are 0 for negative and 1 for positive
+
+                // Apply sigmoid function to the linear combination of the BoW row and the weights
+                double prediction = sigmoid(linearCombination(dataset.row(i)));
+
+                // Clip prediction to avoid log(0)
+                prediction = clip(prediction);
+
+                // Compute the error
+                double error = label - prediction;
+                totalLoss += -label * std::log(prediction) - (1 - label) * std::log(1 - prediction);
+
+                // Update weights and bias
+                double gradient = prediction * (1 - prediction);
+                if (optimizer) {
+                    updateWeightsAdaptive(dataset.row(i), error, gradient, learningRate, regularizationParam);
+                } else {
+                    updateWeights(dataset.row(i), error, gradient, learningRate, regularizationParam);
+                }
+            }
+        }
+        trainingSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-        for (size_t i = 0; i < dataset.getData().size(); ++i) {
-            const auto& sample = dataset.getData()[i];
-            auto tokens = sample.getTokens();
-            int label = sample.getLabel(); // Assume labels are 0 for negative and 1 for positive
+        if (verbose) {
+            // Evaluate on a snapshot of the shared weights
+            if (sharedWeights) {
+                sharedWeights->copyTo(weights);
+                bias = sharedBias.load();
+            }
+            std::cout << "\nEpoch " << epoch + 1 << ", Loss: " << totalLoss << std::endl;
+            double accuracy = evaluate(devDataset);
+            std::cout << "Validation Accuracy: " << accuracy << "%" << std::endl;
+        }
+    }
 
-            // Create feature vector using BoW
-            auto featureVector = createFeatureVectorBoW(tokens, vocabulary);
+    if (sharedWeights) {
+        sharedWeights->copyTo(weights);
+        bias = sharedBias.load();
+    }
+    foldWeightScale();
 
-            // Compute linear combination of features and weights
-            double linearCombination = std::inner_product(featureVector.begin(), featureVector.end(), weights.begin(), 0.0) + bias;
+    if (verbose && trainingSeconds > 0.0) {
+        int threadsUsed = pool ? numThreads : 1;
+        std::cout << "Throughput: " << dataset.numRows() * epochs / trainingSeconds << " samples/sec with "
+                  << threadsUsed << (threadsUsed > 1 ? " threads (Hogwild)" : " thread") << std::endl;
+    }
+}
 
-            // Apply sigmoid function
-            double prediction = sigmoid(linearCombination);
+// Function to compute the regularized mean log-loss and its gradient for parameters = (weights, bias)
+// Map-reduce over the rows: every thread accumulates its shard into its own buffer from shardGradients (allocated
+// once by the caller and reused across calls), then the buffers are summed in thread order with each worker owning
+// a range of parameters, so the result does not depend on scheduling
+double LogisticRegression::lossAndGradient(const CsrMatrix& dataset, const std::vector<double>& parameters, double regularizationParam,
+                                           std::vector<double>& gradient, std::vector<std::vector<double>>& shardGradients,
+                                           ThreadPool& pool) const {
+    size_t numParameters = parameters.size();
+    size_t numWeights = numParameters - 1;
+    int numShards = static_cast<int>(shardGradients.size());
+    std::vector<double> shardLoss(numShards, 0.0);
+
+    // Map: accumulate the residuals of each shard of rows
+    pool.run(numShards, [&](int shard) {
+        std::vector<double>& local = shardGradients[shard];
+        std::fill(local.begin(), local.end(), 0.0);
+        size_t begin = dataset.numRows() * shard / numShards;
+        size_t end = dataset.numRows() * (shard + 1) / numShards;
+        double loss = 0.0;
+
+        for (size_t i = begin; i < end; ++i) {
+            SparseView features = dataset.row(i);
+            int label = dataset.label(i);
+            double z = dot(features, parameters) + parameters[numWeights];
+
+            // log(1 + exp(z)) - label * z, written to stay finite for large |z|
+            loss += std::max(z, 0.0) + std::log1p(std::exp(-std::fabs(z))) - label * z;
+            double residual = 1.0 / (1.0 + std::exp(-z)) - label;
+            axpy(residual, features, local);
+            local[numWeights] += residual;
+        }
+        shardLoss[shard] = loss;
+    });
+
+    // Reduce: sum the shard buffers, scale to the mean and add the L2 term, one range of parameters per worker
+    // The bias is the last parameter and is not regularized
+    double scale = 1.0 / dataset.numRows();
+    gradient.resize(numParameters);
+    std::vector<double> partPenalty(numShards, 0.0);
+    pool.run(numShards, [&](int part) {
+        size_t begin = numParameters * part / numShards;
+        size_t end = numParameters * (part + 1) / numShards;
+        double penalty = 0.0;
+        for (size_t j = begin; j < end; ++j) {
+            double sum = 0.0;
+            for (const std::vector<double>& local : shardGradients) {
+                sum += local[j];
+            }
+            gradient[j] = sum * scale;
+            if (j < numWeights) {
+                penalty += parameters[j] * parameters[j];
+                gradient[j] += regularizationParam * parameters[j];
+            }
+        }
+        partPenalty[part] = penalty;
+    });
 
-            // Clip prediction to avoid log(0)
-            prediction = clip(prediction);
+    double loss = std::accumulate(shardLoss.begin(), shardLoss.end(), 0.0) * scale;
+    return loss + 0.5 * regularizationParam * std::accumulate(partPenalty.begin(), partPenalty.end(), 0.0);
+}
 
-            // Compute the error
-            double error = label - prediction;
-            totalLoss += -label * std::log(prediction) - (1 - label) * std::log(1 - prediction);
+// Function to train the model with limited-memory BFGS
+// Keeps the last historySize parameter and gradient differences to approximate the inverse Hessian
+// (two-loop recursion), then backtracks along the resulting direction until the Armijo condition holds
+void LogisticRegression::trainLbfgs(const CsrMatrix& dataset, const CsrMatrix& devDataset, double regularizationParam, int maxIterations,
+                                    double tolerance, int historySize, bool verbose) {
+    if (dataset.numRows() == 0) {
+        std::cerr << "Cannot train on an empty dataset" << std::endl;
+        return;
+    }
+    if (historySize < 1) {
+        std::cerr << "L-BFGS needs a history of at least one step" << std::endl;
+        return;
+    }
 
-            // Update weights and bias
-            double gradient = prediction * (1 - prediction);
-            updateWeights(featureVector, error, gradient, learningRate);
+    mappedWeights.detach(weights);
+    ThreadPool pool(numThreads);
+    size_t numParameters = weights.size() + 1;
+
+    foldWeightScale();
+    std::vector<double> parameters(weights);
+    parameters.push_back(bias);
+
+    // Per-thread gradient buffers for lossAndGradient, shared by every evaluation including the line-search trials
+    std::vector<std::vector<double>> shardGradients(pool.size(), std::vector<double>(numParameters));
+    std::vector<double> gradient;
+    double loss = lossAndGradient(dataset, parameters, regularizationParam, gradient, shardGradients, pool);
+
+    // Ring buffers of the last parameter steps s, gradient changes y and 1 / (y . s)
+    std::vector<std::vector<double>> steps, gradientChanges;
+    std::vector<double> rho;
+    std::vector<double> direction(numParameters), alpha(historySize);
+    std::vector<double> candidate(numParameters), candidateGradient;
+
+    auto norm = [](const std::vector<double>& v) {
+        return std::sqrt(std::inner_product(v.begin(), v.end(), v.begin(), 0.0));
+    };
+
+    for (int iteration = 0; iteration < maxIterations; ++iteration) {
+        double gradientNorm = norm(gradient);
+        if (gradientNorm <= tolerance * std::max(1.0, norm(parameters))) {
+            break;
+        }
 
-//            if (verbose) {
-//                std::cout << "\rEpoch " << epoch + 1 << "/" << epochs
-//                          << ", Sample " << i + 1 << "/" << dataset.getData().size() << std::flush;
-//            }
+        // Two-loop recursion: direction = -H * gradient
+        for (size_t j = 0; j < numParameters; ++j) {
+            direction[j] = -gradient[j];
+        }
+        int history = static_cast<int>(steps.size());
+        for (int k = history - 1; k >= 0; --k) {
+            alpha[k] = rho[k] * std::inner_product(steps[k].begin(), steps[k].end(), direction.begin(), 0.0);
+            for (size_t j = 0; j < numParameters; ++j) {
+                direction[j] -= alpha[k] * gradientChanges[k][j];
+            }
+        }
+        if (history > 0) {
+            // Scale by the curvature of the most recent step as the initial Hessian estimate
+            const std::vector<double>& y = gradientChanges[history - 1];
+            double gamma = 1.0 / (rho[history - 1] * std::inner_product(y.begin(), y.end(), y.begin(), 0.0));
+            for (double& value : direction) {
+                value *= gamma;
+            }
+        }
+        for (int k = 0; k < history; ++k) {
+            double beta = rho[k] * std::inner_product(gradientChanges[k].begin(), gradientChanges[k].end(), direction.begin(), 0.0);
+            for (size_t j = 0; j < numParameters; ++j) {
+                direction[j] += (alpha[k] - beta) * steps[k][j];
+            }
         }
 
-        if (verbose) {
-            std::cout << "\nEpoch " << epoch + 1 << ", Loss: " << totalLoss << std::endl;
-            double accuracy = evaluate(devDataset, vocabulary);
-            std::cout << "Validation Accuracy: " << accuracy << "%" << std::endl;
+        double slope = std::inner_product(gradient.begin(), gradient.end(), direction.begin(), 0.0);
+        if (slope >= 0.0) {
+            // Not a descent direction: drop the history and fall back to steepest descent
+            steps.clear();
+            gradientChanges.clear();
+            rho.clear();
+            for (size_t j = 0; j < numParameters; ++j) {
+                direction[j] = -gradient[j];
+            }
+            slope = -gradientNorm * gradientNorm;
         }
-    }
-}
 
-// Function to save model weights and bias to a file
-// Stores the model parameters in a binary file for later use
-void LogisticRegression::saveWeights(const std::string& filename) const {
-    std::ofstream outFile(filename, std::ios::out | std::ios::binary);
+        // Backtracking line search; the first iteration has no curvature estimate, so it starts at a unit-length step
+        double stepSize = history == 0 ? 1.0 / gradientNorm : 1.0;
+        double candidateLoss = loss;
+        bool accepted = false;
+        for (int trial = 0; trial < 30; ++trial) {
+            for (size_t j = 0; j < numParameters; ++j) {
+                candidate[j] = parameters[j] + stepSize * direction[j];
+            }
+            candidateLoss = lossAndGradient(dataset, candidate, regularizationParam, candidateGradient, shardGradients, pool);
+            if (candidateLoss <= loss + 1e-4 * stepSize * slope) {
+                accepted = true;
+                break;
+            }
+            stepSize *= 0.5;
+        }
+        if (!accepted) {
+            break;
+        }
 
-    if (!outFile.is_open()) {
-        std::cerr << "Error opening file for saving weights: " << filename << std::endl;
-        return;
+        // Remember the step and gradient change if they carry positive curvature
+        std::vector<double> s(numParameters), y(numParameters);
+        for (size_t j = 0; j < numParameters; ++j) {
+            s[j] = candidate[j] - parameters[j];
+            y[j] = candidateGradient[j] - gradient[j];
+        }
+        double curvature = std::inner_product(y.begin(), y.end(), s.begin(), 0.0);
+        if (curvature > 1e-10) {
+            if (static_cast<int>(steps.size()) == historySize) {
+                steps.erase(steps.begin());
+                gradientChanges.erase(gradientChanges.begin());
+                rho.erase(rho.begin());
+            }
+            steps.push_back(std::move(s));
+            gradientChanges.push_back(std::move(y));
+            rho.push_back(1.0 / curvature);
+        }
+
+        double improvement = (loss - candidateLoss) / std::max({std::fabs(loss), std::fabs(candidateLoss), 1.0});
+        parameters.swap(candidate);
+        gradient.swap(candidateGradient);
+        loss = candidateLoss;
+
+        if (verbose) {
+            std::cout << "Iteration " << iteration + 1 << ", Loss: " << loss << ", Gradient norm: " << norm(gradient) << std::endl;
+        }
+        if (improvement < tolerance) {
+            break;
+        }
     }
 
-    // Save model parameters (numFeatures)
-    outFile.write(reinterpret_cast<const char*>(&numFeatures), sizeof(numFeatures));
+    bias = parameters.back();
+    parameters.pop_back();
+    weights.swap(parameters);
 
-    // Save weights
-    for (double weight : weights) {
-        outFile.write(reinterpret_cast<const char*>(&weight), sizeof(weight));
+    if (verbose) {
+        double accuracy = evaluate(devDataset);
+        std::cout << "Validation Accuracy: " << accuracy << "%" << std::endl;
     }
+}
+
+// Function to set the number of training threads; 0 uses all hardware threads
+void LogisticRegression::setNumThreads(int threads) {
+    numThreads = threads > 0 ? threads : ThreadPool::defaultThreadCount();
+}
 
-    // Save bias
-    outFile.write(reinterpret_cast<const char*>(&bias), sizeof(bias));
+// Function to set the optimizer used by train; pass nullptr to go back to plain SGD
+void LogisticRegression::setOptimizer(std::unique_ptr<Optimizer> newOptimizer) {
+    optimizer = std::move(newOptimizer);
+}
 
-    outFile.close();
+// Function to save model weights and bias to a file
+// Stores the model parameters in a binary file for later use
+void LogisticRegression::saveWeights(const std::string& filename) const {
+    modelWriter().write(filename);
 }
 
 // Function to load model weights and bias from a file
-// Restores the model parameters from a binary file
-bool LogisticRegression::loadWeights(const std::string& filename) {
-    std::ifstream inFile(filename, std::ios::in | std::ios::binary);
+// The file is mapped and the weights are used in place. A model built with features must match the file;
+// one built with 0 features takes the number of features from the file.
+bool LogisticRegression::loadWeights(const std::string& filename, bool verifyChecksums) {
+    ModelFile file;
+    return file.open(filename, ModelType::LogisticRegression, verifyChecksums)
+           && useModelFile(std::move(file), numFeatures > 0 ? numFeatures : -1);
+}
 
-    if (!inFile.is_open()) {
-        std::cerr << "Error opening file for loading weights: " << filename << std::endl;
-        return false;
-    }
+// Function to save the model together with its vocabulary, so it can be used without the training data
+void LogisticRegression::saveBundle(const std::string& filename, const Vocabulary& vocabulary, uint64_t stopwordsHash) const {
+    ModelBundle::save(filename, modelWriter(), vocabulary, stopwordsHash);
+}
 
-    // Load model parameters and check for consistency
-    int loadedNumFeatures;
+// Function to load a bundle saved by saveBundle
+bool LogisticRegression::loadBundle(const std::string& filename, uint64_t stopwordsHash, Vocabulary& vocabulary, bool verifyChecksums) {
+    return ModelBundle::load(filename, ModelType::LogisticRegression, stopwordsHash, vocabulary, verifyChecksums,
+                             [this](ModelFile&& file, int expectedFeatures) { return useModelFile(std::move(file), expectedFeatures); });
+}
 
-    inFile.read(reinterpret_cast<char*>(&loadedNumFeatures), sizeof(loadedNumFeatures));
+// Function to collect the sections of a saved model: numFeatures and the bias, then the weights
+ModelFileWriter LogisticRegression::modelWriter() const {
+    ModelFileWriter writer(ModelType::LogisticRegression);
+    MappedWeights::addSections(writer, weightValues(), static_cast<size_t>(numFeatures), bias);
+    return writer;
+}
 
-    if (loadedNumFeatures != numFeatures) {
-        std::cerr << "Model parameters do not match: "
-                  << "Expected numFeatures: " << numFeatures
-                  << ", but got numFeatures: " << loadedNumFeatures << "." << std::endl;
-        inFile.close();
+// Function to point the model at the weights of a mapped model file
+// A non-negative expectedFeatures must match the number of features in the file; the model is untouched on failure
+bool LogisticRegression::useModelFile(ModelFile&& file, int expectedFeatures) {
+    if (!mappedWeights.open(std::move(file), expectedFeatures, bias)) {
         return false;
     }
-
-    // Load weights
-    for (double& weight : weights) {
-        inFile.read(reinterpret_cast<char*>(&weight), sizeof(weight));
-    }
-
-    // Load bias
-    inFile.read(reinterpret_cast<char*>(&bias), sizeof(bias));
-
-    inFile.close();
+    numFeatures = static_cast<int>(mappedWeights.size());
+    weightScale = 1.0;
+    std::vector<double>().swap(weights);
     return true;
 }
@@ -2,6 +2,11 @@
 #define SENTIMENTANALYSIS_LOGISTICREGRESSION_H
 
 #include "Twitter.h"
+#include "Vocabulary.h"
+#include "AtomicWeights.h"
+#include "ThreadPool.h"
+#include "Optimizer.h"
+#include "ModelBundle.h"
 #include <cmath>
 #include <random>
 #include <numeric>
@@ -9,24 +14,50 @@
 
 class LogisticRegression {
 private:
-    std::vector<double> weights;
+    std::vector<double> weights; // Effective weights are weightScale * weights (lazy L2 regularization)
+    double weightScale = 1.0;
     double bias;
     int numFeatures;
+    int numThreads = 1; // More than one thread trains with lock-free Hogwild SGD
+    std::unique_ptr<Optimizer> optimizer; // Per-feature update rule; null for the built-in SGD with lazy L2
+    MappedWeights mappedWeights;          // Loaded model file; while it is open the weights are read from it in place
 
-    std::vector<double> createFeatureVectorBoW(const std::vector<std::string>& tokens, const std::unordered_map<std::string, int>& vocabulary);
     double sigmoid(double z);
-    void updateWeights(const std::vector<double>& features, double error, double gradient, double learningRate);
+    double linearCombination(const SparseView& features) const;
+    void updateWeights(const SparseView& features, double error, double gradient, double learningRate, double regularizationParam);
+    void foldWeightScale();
+    void updateWeightsAdaptive(const SparseView& features, double error, double gradient, double learningRate, double regularizationParam);
+    double trainEpochHogwild(const CsrMatrix& dataset, ThreadPool& pool, AtomicWeights& sharedWeights, AtomicBias& sharedBias,
+                             double learningRate, double regularizationParam);
     double clip(double value, double epsilon = 1e-10);
+    double lossAndGradient(const CsrMatrix& dataset, const std::vector<double>& parameters, double regularizationParam,
+                           std::vector<double>& gradient, std::vector<std::vector<double>>& shardGradients,
+                           ThreadPool& pool) const;
+    const double* weightValues() const { return mappedWeights.isOpen() ? mappedWeights.data() : weights.data(); }
+    ModelFileWriter modelWriter() const;
+    bool useModelFile(ModelFile&& file, int expectedFeatures);
 
 public:
     LogisticRegression(int numFeatures);
-    void train(Dataset& dataset, const std::unordered_map<std::string, int>& vocabulary, Dataset& devDataset, double learningRate, int epochs, bool verbose=true);
-    int predict(const std::vector<std::string>& tokens, const std::unordered_map<std::string, int>& vocabulary);
-    double evaluate(Dataset& dataset, const std::unordered_map<std::string, int>& vocabulary);
+    void train(const CsrMatrix& dataset, const CsrMatrix& devDataset, double learningRate, int epochs, double regularizationParam = 0.0, bool verbose=true);
+    // Full-batch L-BFGS on the mean log-loss plus (regularizationParam / 2) * ||w||^2, with a backtracking line search
+    // Stops when the gradient norm or the relative loss improvement falls below the tolerance
+    void trainLbfgs(const CsrMatrix& dataset, const CsrMatrix& devDataset, double regularizationParam = 0.0, int maxIterations = 100,
+                    double tolerance = 1e-5, int historySize = 10, bool verbose = true);
+    void setNumThreads(int threads);
+    // Train with an adaptive optimizer instead of plain SGD; such training runs on a single thread
+    void setOptimizer(std::unique_ptr<Optimizer> newOptimizer);
+    int predict(TokenView tokens, const Vocabulary& vocabulary);
+    double evaluate(const CsrMatrix& dataset);
 
     // Functions for saving and loading model weights
     void saveWeights(const std::string& filename) const;
-    bool loadWeights(const std::string& filename);
+    // Loading maps the file in place; verifyChecksums = false skips hashing the weights, so loading is O(1)
+    bool loadWeights(const std::string& filename, bool verifyChecksums = true);
+
+    // Save or load a self-contained bundle with the vocabulary the weights are indexed by
+    void saveBundle(const std::string& filename, const Vocabulary& vocabulary, uint64_t stopwordsHash) const;
+    bool loadBundle(const std::string& filename, uint64_t stopwordsHash, Vocabulary& vocabulary, bool verifyChecksums = true);
 
     // Getters for validation purposes
     int getNumFeatures() const { return numFeatures; }
@@ -0,0 +1,155 @@
+#include "MappedFile.h"
+
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Constructor that maps the given file immediately
+// Use isOpen() to check whether the mapping succeeded
+MappedFile::MappedFile(const std::string &filename, MapMode mode) {
+    open(filename, mode);
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+        std::swap(opened, other.opened);
+        std::swap(writable, other.writable);
+#ifdef _WIN32
+        std::swap(fileHandle, other.fileHandle);
+        std::swap(mappingHandle, other.mappingHandle);
+#endif
+    }
+    return *this;
+}
+
+// Function to map a file into memory for reading
+// Empty files are reported as open with a null data pointer and zero size
+bool MappedFile::open(const std::string &filename, MapMode mode) {
+    close();
+    bool sequential = mode == MapMode::Sequential;
+    bool copyOnWrite = mode == MapMode::CopyOnWrite;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        std::cerr << "Error reading file size: " << filename << std::endl;
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    length = static_cast<size_t>(fileSize.QuadPart);
+    opened = true;
+    if (length == 0) {
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        std::cerr << "Error mapping file: " << filename << std::endl;
+        close();
+        return false;
+    }
+    mappingHandle = mapping;
+
+    bytes = static_cast<char *>(MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+    if (bytes == nullptr) {
+        std::cerr << "Error mapping file: " << filename << std::endl;
+        close();
+        return false;
+    }
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return false;
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+        std::cerr << "Error reading file size: " << filename << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    length = static_cast<size_t>(st.st_size);
+    opened = true;
+    if (length == 0) {
+        ::close(fd);
+        return true;
+    }
+
+    int protection = copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *address = mmap(nullptr, length, protection, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file, so the descriptor is no longer needed
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        std::cerr << "Error mapping file: " << filename << std::endl;
+        length = 0;
+        opened = false;
+        return false;
+    }
+
+    // Loaders that scan the file front to back let the kernel read ahead aggressively
+    madvise(address, length, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    bytes = static_cast<char *>(address);
+#endif
+
+    writable = copyOnWrite;
+    return true;
+}
+
+// Function to release the mapping and any handles held by the object
+void MappedFile::close() {
+#ifdef _WIN32
+    if (bytes != nullptr) {
+        UnmapViewOfFile(bytes);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != nullptr) {
+        CloseHandle(fileHandle);
+    }
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (bytes != nullptr) {
+        munmap(bytes, length);
+    }
+#endif
+    bytes = nullptr;
+    length = 0;
+    opened = false;
+    writable = false;
+}
+
+bool MappedFile::isOpen() const {
+    return opened;
+}
@@ -0,0 +1,51 @@
+#ifndef SENTIMENTANALYSIS_MAPPEDFILE_H
+#define SENTIMENTANALYSIS_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// How a file is mapped and accessed
+enum class MapMode {
+    Sequential,  // Read-only, read ahead aggressively for a front-to-back scan
+    Random,      // Read-only, no read-ahead for files accessed at random
+    CopyOnWrite  // Random access with writable private pages: writes are never written back to the file, and
+                 // pages that are not written stay shared with every other process mapping the file
+};
+
+// Memory mapping of a whole file
+// The mapped bytes stay valid until the object is closed or destroyed
+class MappedFile {
+private:
+    char *bytes = nullptr;
+    size_t length = 0;
+    bool opened = false;
+    bool writable = false;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &filename, MapMode mode = MapMode::Sequential);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    bool open(const std::string &filename, MapMode mode = MapMode::Sequential);
+    void close();
+
+    bool isOpen() const;
+    const char *data() const { return bytes; }
+    // Writable view of a copy-on-write mapping, nullptr for read-only mappings
+    char *writableData() const { return writable ? bytes : nullptr; }
+    size_t size() const { return length; }
+    std::string_view view() const { return {bytes, length}; }
+};
+
+
+#endif //SENTIMENTANALYSIS_MAPPEDFILE_H
@@ -0,0 +1,123 @@
+#include "ModelBundle.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "TextPreprocessor.h"
+
+#include <iostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Contents of SECTION_BUNDLE
+struct BundleHeader {
+    uint32_t preprocessorVersion;
+    uint32_t vocabularySize;
+    uint64_t stopwordsHash;
+};
+
+}
+
+// Function to hash a stopword file the same way as the dataset cache key
+uint64_t ModelBundle::stopwordsHash(const std::string &filename) {
+    MappedFile file(filename);
+    return hashBytes(file.data(), file.size());
+}
+
+// Function to add the bundle header: the preprocessing the model expects and its vocabulary size
+void ModelBundle::addHeader(ModelFileWriter &writer, uint32_t vocabularySize, uint64_t stopwordsHash) {
+    writer.addValue(SECTION_BUNDLE, BundleHeader{static_cast<uint32_t>(TextPreprocessor::VERSION), vocabularySize, stopwordsHash});
+}
+
+// Function to read the bundle header of a model file
+// Fails if the bundle does not match what this process would feed the model
+bool ModelBundle::readHeader(const ModelFile &file, uint64_t stopwordsHash, uint32_t &vocabularySize) {
+    BundleHeader header{};
+    if (!file.value(SECTION_BUNDLE, header)) {
+        std::cerr << "Model file is not a bundle, it holds no vocabulary: " << file.name() << std::endl;
+        return false;
+    }
+    if (header.preprocessorVersion != static_cast<uint32_t>(TextPreprocessor::VERSION)) {
+        std::cerr << "Model bundle was built with preprocessing version " << header.preprocessorVersion
+                  << ", but this program uses version " << TextPreprocessor::VERSION << ": " << file.name() << std::endl;
+        return false;
+    }
+    if (header.stopwordsHash != stopwordsHash) {
+        std::cerr << "Model bundle was trained with a different stopword list: " << file.name() << std::endl;
+        return false;
+    }
+    vocabularySize = header.vocabularySize;
+    return true;
+}
+
+// Function to add the bundle header and the vocabulary tokens, in feature id order
+void ModelBundle::addVocabulary(ModelFileWriter &writer, const Vocabulary &vocabulary, uint64_t stopwordsHash) {
+    std::string offsets;
+    std::string tokens;
+    uint32_t offset = 0;
+    offsets.append(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    for (int feature = 0; feature < vocabulary.size(); ++feature) {
+        tokens += vocabulary.token(feature);
+        offset = static_cast<uint32_t>(tokens.size());
+        offsets.append(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    }
+
+    addHeader(writer, static_cast<uint32_t>(vocabulary.size()), stopwordsHash);
+    writer.addOwned(SECTION_TOKEN_OFFSETS, std::move(offsets));
+    writer.addOwned(SECTION_TOKENS, std::move(tokens));
+}
+
+// Function to read the bundle sections of a model file
+// Fails without touching the vocabulary if the bundle does not match what this process would feed the model
+bool ModelBundle::readVocabulary(const ModelFile &file, uint64_t stopwordsHash, Vocabulary &vocabulary) {
+    uint32_t vocabularySize = 0;
+    if (!readHeader(file, stopwordsHash, vocabularySize)) {
+        return false;
+    }
+
+    size_t stringBytes = 0;
+    const char *strings = file.section(SECTION_TOKENS, stringBytes);
+    const auto *offsets = file.array<uint32_t>(SECTION_TOKEN_OFFSETS, static_cast<size_t>(vocabularySize) + 1);
+    if (strings == nullptr || offsets == nullptr
+        || offsets[0] != 0 || offsets[vocabularySize] != stringBytes) {
+        std::cerr << "Corrupt model bundle: " << file.name() << std::endl;
+        return false;
+    }
+
+    std::vector<std::string_view> tokens;
+    tokens.reserve(vocabularySize);
+    for (uint32_t feature = 0; feature < vocabularySize; ++feature) {
+        if (offsets[feature] > offsets[feature + 1]) {
+            std::cerr << "Corrupt model bundle: " << file.name() << std::endl;
+            return false;
+        }
+        tokens.emplace_back(strings + offsets[feature], offsets[feature + 1] - offsets[feature]);
+    }
+
+    vocabulary = Vocabulary(tokens);
+    return true;
+}
+
+// Function to save a model with its vocabulary
+bool ModelBundle::save(const std::string &filename, ModelFileWriter writer, const Vocabulary &vocabulary, uint64_t stopwordsHash) {
+    addVocabulary(writer, vocabulary, stopwordsHash);
+    if (!writer.write(filename)) {
+        return false;
+    }
+    std::cout << "Model bundle saved to " << filename << std::endl;
+    return true;
+}
+
+// Function to load a bundle: the file, then the vocabulary, then the model
+bool ModelBundle::load(const std::string &filename, ModelType type, uint64_t stopwordsHash, Vocabulary &vocabulary, bool verifyChecksums,
+                       const std::function<bool(ModelFile &&, int)> &useModelFile) {
+    ModelFile file;
+    Vocabulary loaded;
+    if (!file.open(filename, type, verifyChecksums) || !readVocabulary(file, stopwordsHash, loaded)
+        || !useModelFile(std::move(file), loaded.size())) {
+        return false;
+    }
+    vocabulary = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef SENTIMENTANALYSIS_MODELBUNDLE_H
+#define SENTIMENTANALYSIS_MODELBUNDLE_H
+
+#include "ModelFile.h"
+#include "Vocabulary.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Self-contained saved model: a model file that also holds the frozen vocabulary the weights are indexed by and
+// the preprocessing it expects (pipeline version and stopword hash). Loading one needs neither the training data
+// nor a rebuilt vocabulary. The model type and dimensions are in the model file itself.
+class ModelBundle {
+public:
+    // Hash of a stopword file, as recorded in a bundle
+    static uint64_t stopwordsHash(const std::string &filename);
+
+    // Add the bundle header alone, for a model that stores its vocabulary in its own sections
+    static void addHeader(ModelFileWriter &writer, uint32_t vocabularySize, uint64_t stopwordsHash);
+
+    // Check the bundle header against the preprocessing version and the stopwords of this process
+    static bool readHeader(const ModelFile &file, uint64_t stopwordsHash, uint32_t &vocabularySize);
+
+    // Add the bundle sections for a vocabulary to a model being saved
+    static void addVocabulary(ModelFileWriter &writer, const Vocabulary &vocabulary, uint64_t stopwordsHash);
+
+    // Check the bundle sections against the preprocessing version and the stopwords of this process, then
+    // restore the vocabulary
+    static bool readVocabulary(const ModelFile &file, uint64_t stopwordsHash, Vocabulary &vocabulary);
+
+    // Write a model's sections together with the bundle sections for its vocabulary
+    static bool save(const std::string &filename, ModelFileWriter writer, const Vocabulary &vocabulary, uint64_t stopwordsHash);
+
+    // Open a bundle of the given model type and restore its vocabulary, then let the model take over the file,
+    // given the vocabulary size its input must match. The vocabulary is only replaced if every step succeeds.
+    static bool load(const std::string &filename, ModelType type, uint64_t stopwordsHash, Vocabulary &vocabulary, bool verifyChecksums,
+                     const std::function<bool(ModelFile &&, int)> &useModelFile);
+};
+
+
+#endif //SENTIMENTANALYSIS_MODELBUNDLE_H
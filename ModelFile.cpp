@@ -0,0 +1,221 @@
+#include "ModelFile.h"
+#include "DenseKernels.h"
+#include "Hash.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace {
+
+const char MODEL_MAGIC[8] = {'S', 'A', 'M', 'O', 'D', 'E', 'L', '\0'};
+const uint32_t FORMAT_VERSION = 1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t modelType;
+    uint32_t numSections;
+    uint32_t reserved;
+    uint64_t fileSize;
+    uint64_t checksum; // Hash of the fields above and the section table
+};
+
+// Round an offset up to the section alignment
+uint64_t alignOffset(uint64_t offset) {
+    return (offset + KERNEL_ALIGNMENT - 1) / KERNEL_ALIGNMENT * KERNEL_ALIGNMENT;
+}
+
+// Contents of SECTION_META for MappedWeights
+struct LinearModelMeta {
+    int32_t numWeights;
+    int32_t reserved;
+    double bias;
+};
+
+uint64_t headerChecksum(const FileHeader &header, const void *table, size_t tableSize) {
+    return hashBytes(table, tableSize, hashBytes(&header, offsetof(FileHeader, checksum)));
+}
+
+// Replace target with source in one step, so readers see either the old file or the new one
+bool replaceFile(const std::string &source, const std::string &target) {
+#ifdef _WIN32
+    return MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(source.c_str(), target.c_str()) == 0;
+#endif
+}
+
+}
+
+// Function to write the sections to a model file
+// Sections are laid out in the order they were added, padded with zeros up to each aligned start
+bool ModelFileWriter::write(const std::string &filename) const {
+    std::vector<ModelFile::SectionEntry> table;
+    table.reserve(sections.size());
+    uint64_t offset = sizeof(FileHeader) + sections.size() * sizeof(ModelFile::SectionEntry);
+    std::vector<const char *> data;
+    for (const Section &section : sections) {
+        data.push_back(section.owned >= 0 ? ownedData[section.owned].data() : static_cast<const char *>(section.data));
+        offset = alignOffset(offset);
+        table.push_back({section.tag, 0, offset, section.size, hashBytes(data.back(), section.size)});
+        offset += section.size;
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC));
+    header.version = FORMAT_VERSION;
+    header.modelType = static_cast<uint32_t>(type);
+    header.numSections = static_cast<uint32_t>(sections.size());
+    header.fileSize = offset;
+    header.checksum = headerChecksum(header, table.data(), table.size() * sizeof(ModelFile::SectionEntry));
+
+    // Sections may point into a mapping of the file being replaced, by this or another process, so the file is
+    // never truncated in place: the new contents go to a temporary file that is renamed over it once complete
+    std::string tempFilename = filename + ".tmp";
+    std::ofstream outFile(tempFilename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!outFile.is_open()) {
+        std::cerr << "Error opening file for saving model: " << tempFilename << std::endl;
+        return false;
+    }
+
+    const char padding[KERNEL_ALIGNMENT] = {};
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    outFile.write(reinterpret_cast<const char *>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(ModelFile::SectionEntry)));
+    uint64_t written = sizeof(FileHeader) + table.size() * sizeof(ModelFile::SectionEntry);
+    for (size_t i = 0; i < sections.size(); ++i) {
+        outFile.write(padding, static_cast<std::streamsize>(table[i].offset - written));
+        outFile.write(data[i], static_cast<std::streamsize>(sections[i].size));
+        written = table[i].offset + sections[i].size;
+    }
+    outFile.flush();
+    bool good = outFile.good();
+    outFile.close();
+
+    if (!good || outFile.fail()) {
+        std::cerr << "Error writing model: " << tempFilename << std::endl;
+        std::remove(tempFilename.c_str());
+        return false;
+    }
+    if (!replaceFile(tempFilename, filename)) {
+        std::cerr << "Error replacing model file: " << filename << std::endl;
+        std::remove(tempFilename.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Function to map a model file and check its header, section table and optionally every section
+// Returns false with an error message if the file is missing, corrupt, from another format version or for another model
+bool ModelFile::open(const std::string &path, ModelType type, bool verifyChecksums) {
+    close();
+    MappedFile mapped;
+    if (!mapped.open(path, MapMode::CopyOnWrite)) {
+        return false;
+    }
+
+    FileHeader header{};
+    if (mapped.size() >= sizeof(header)) {
+        std::memcpy(&header, mapped.data(), sizeof(header));
+    }
+    if (std::memcmp(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC)) != 0) {
+        std::cerr << "Not a model file: " << path << std::endl;
+        return false;
+    }
+    if (header.version != FORMAT_VERSION) {
+        std::cerr << "Unsupported model file version " << header.version << ": " << path << std::endl;
+        return false;
+    }
+
+    size_t tableSize = static_cast<size_t>(header.numSections) * sizeof(SectionEntry);
+    if (header.fileSize != mapped.size() || mapped.size() - sizeof(FileHeader) < tableSize
+        || header.checksum != headerChecksum(header, mapped.data() + sizeof(FileHeader), tableSize)) {
+        std::cerr << "Corrupt model file: " << path << std::endl;
+        return false;
+    }
+    if (header.modelType != static_cast<uint32_t>(type)) {
+        std::cerr << "Model file holds another type of model: " << path << std::endl;
+        return false;
+    }
+
+    // The table starts right after the 40-byte header, so its entries are 8-byte aligned in the mapping
+    auto table = reinterpret_cast<const SectionEntry *>(mapped.data() + sizeof(FileHeader));
+    for (uint32_t i = 0; i < header.numSections; ++i) {
+        const SectionEntry &entry = table[i];
+        bool inBounds = entry.offset % KERNEL_ALIGNMENT == 0 && entry.offset <= mapped.size() && entry.size <= mapped.size() - entry.offset;
+        if (!inBounds || (verifyChecksums && hashBytes(mapped.data() + entry.offset, entry.size) != entry.checksum)) {
+            std::cerr << "Corrupt model file: " << path << std::endl;
+            return false;
+        }
+    }
+
+    file = std::move(mapped);
+    filename = path;
+    entries = table;
+    numSections = header.numSections;
+    return true;
+}
+
+void ModelFile::close() {
+    file.close();
+    filename.clear();
+    entries = nullptr;
+    numSections = 0;
+}
+
+char *ModelFile::section(uint32_t tag, size_t &size) const {
+    for (uint32_t i = 0; i < numSections; ++i) {
+        if (entries[i].tag == tag) {
+            size = entries[i].size;
+            return file.writableData() + entries[i].offset;
+        }
+    }
+    size = 0;
+    return nullptr;
+}
+
+// Function to point at the weights section of a linear model file
+bool MappedWeights::open(ModelFile &&source, int expectedCount, double &bias) {
+    LinearModelMeta meta{};
+    const double *weights = nullptr;
+    if (source.value(SECTION_META, meta) && meta.numWeights >= 0) {
+        weights = source.array<double>(SECTION_WEIGHTS, meta.numWeights);
+    }
+    if (weights == nullptr) {
+        std::cerr << "Corrupt model file: " << source.name() << std::endl;
+        return false;
+    }
+    if (expectedCount >= 0 && meta.numWeights != expectedCount) {
+        std::cerr << "Model parameters do not match: expected " << expectedCount << " weights, but "
+                  << source.name() << " has " << meta.numWeights << std::endl;
+        return false;
+    }
+
+    bias = meta.bias;
+    values = weights;
+    count = meta.numWeights;
+    file = std::move(source);
+    return true;
+}
+
+// Function to copy the mapped weights out and release the file
+void MappedWeights::detach(std::vector<double> &owned) {
+    if (file.isOpen()) {
+        owned.assign(values, values + count);
+        values = nullptr;
+        count = 0;
+        file.close();
+    }
+}
+
+// Function to add the number of weights, the bias and the weights
+void MappedWeights::addSections(ModelFileWriter &writer, const double *weights, size_t count, double bias) {
+    writer.addValue(SECTION_META, LinearModelMeta{static_cast<int32_t>(count), 0, bias});
+    writer.add(SECTION_WEIGHTS, weights, count * sizeof(double));
+}
@@ -0,0 +1,151 @@
+#ifndef SENTIMENTANALYSIS_MODELFILE_H
+#define SENTIMENTANALYSIS_MODELFILE_H
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+enum class ModelType : uint32_t {
+    LogisticRegression = 1,
+    SimpleSVM = 2,
+    NeuralNetwork = 3,
+    FTRLProximal = 4,
+    NaiveBayes = 5
+};
+
+// Four-character tag naming a section of a model file
+constexpr uint32_t sectionTag(const char (&name)[5]) {
+    return static_cast<uint32_t>(static_cast<unsigned char>(name[0]))
+           | static_cast<uint32_t>(static_cast<unsigned char>(name[1])) << 8
+           | static_cast<uint32_t>(static_cast<unsigned char>(name[2])) << 16
+           | static_cast<uint32_t>(static_cast<unsigned char>(name[3])) << 24;
+}
+
+// Section tags shared by the models
+constexpr uint32_t SECTION_META = sectionTag("META");       // Model-specific fixed-size header
+constexpr uint32_t SECTION_WEIGHTS = sectionTag("WGHT");    // Dense parameter array
+constexpr uint32_t SECTION_INDICES = sectionTag("INDX");    // Feature ids of sparse weights
+constexpr uint32_t SECTION_BUNDLE = sectionTag("BNDL");     // Preprocessing a bundled model expects
+constexpr uint32_t SECTION_TOKEN_OFFSETS = sectionTag("VOFF"); // Vocabulary: start of each token in SECTION_TOKENS
+constexpr uint32_t SECTION_TOKENS = sectionTag("VSTR");     // Vocabulary: token bytes in feature id order
+constexpr uint32_t SECTION_TOKEN_HASH = sectionTag("VHSH"); // Vocabulary: hash table from token to feature id
+
+// Collects the sections of a model and writes them in the shared model file format
+// Sections added by pointer are not copied, so their data must stay valid until write returns
+class ModelFileWriter {
+private:
+    struct Section {
+        uint32_t tag;
+        const void *data;
+        size_t size;
+        int owned; // Index in ownedData, or -1 for data added by pointer
+    };
+
+    ModelType type;
+    std::vector<Section> sections;
+    std::vector<std::string> ownedData;
+
+public:
+    explicit ModelFileWriter(ModelType type) : type(type) {}
+
+    void add(uint32_t tag, const void *data, size_t size) { sections.push_back({tag, data, size, -1}); }
+    template <typename T>
+    void add(uint32_t tag, const std::vector<T> &values) { add(tag, values.data(), values.size() * sizeof(T)); }
+    // Copy a small value, such as a META struct, into the writer
+    template <typename T>
+    void addValue(uint32_t tag, const T &value) {
+        addOwned(tag, std::string(reinterpret_cast<const char *>(&value), sizeof(T)));
+    }
+    // Take ownership of section bytes built only for the file
+    void addOwned(uint32_t tag, std::string bytes) {
+        sections.push_back({tag, nullptr, bytes.size(), static_cast<int>(ownedData.size())});
+        ownedData.push_back(std::move(bytes));
+    }
+
+    bool write(const std::string &filename) const;
+};
+
+// A model file mapped into memory
+// Layout: header, section table, then every section starting on a 64-byte boundary, so arrays of doubles can be
+// used in place by the AVX kernels. The header carries a checksum of itself and the section table, and every
+// table entry a checksum of its section. The mapping is copy-on-write: a model can point its parameters at a
+// section and even keep training on them, and only the pages it writes stop being shared with other processes.
+class ModelFile {
+private:
+    struct SectionEntry {
+        uint32_t tag;
+        uint32_t reserved;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t checksum;
+    };
+
+    MappedFile file;
+    std::string filename;
+    const SectionEntry *entries = nullptr;
+    uint32_t numSections = 0;
+
+    friend class ModelFileWriter;
+
+public:
+    // Map a model file of the given type
+    // The header and section table are always checked. verifyChecksums also hashes every section, which reads
+    // the whole file; without it opening costs O(1) and sections are paged in as the model touches them.
+    bool open(const std::string &path, ModelType type, bool verifyChecksums = true);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+    const std::string &name() const { return filename; }
+
+    // Start and size in bytes of a section, or nullptr if the file has no such section
+    char *section(uint32_t tag, size_t &size) const;
+
+    // A section as an array of count values of T, or nullptr if it is missing or its size does not match
+    template <typename T>
+    T *array(uint32_t tag, size_t count) const {
+        size_t size = 0;
+        char *data = section(tag, size);
+        return data != nullptr && size == count * sizeof(T) ? reinterpret_cast<T *>(data) : nullptr;
+    }
+
+    // Copy a fixed-size section into value; false if it is missing or has another size
+    template <typename T>
+    bool value(uint32_t tag, T &value) const {
+        size_t size = 0;
+        char *data = section(tag, size);
+        if (data == nullptr || size != sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, data, sizeof(T));
+        return true;
+    }
+};
+
+// Weights and bias of a linear model, read in place from a mapped model file
+// SECTION_META holds the number of weights and the bias, SECTION_WEIGHTS the weights
+class MappedWeights {
+private:
+    ModelFile file;
+    const double *values = nullptr;
+    size_t count = 0;
+
+public:
+    // Take over an opened model file; a non-negative expectedCount must match its number of weights, since the
+    // weights are read through a raw pointer
+    // On success bias is set from the file; on failure nothing changes
+    bool open(ModelFile &&source, int expectedCount, double &bias);
+    // Copy the weights into owned storage and close the file, before training changes them
+    void detach(std::vector<double> &owned);
+    bool isOpen() const { return file.isOpen(); }
+    const double *data() const { return values; }
+    size_t size() const { return count; }
+
+    // Add the sections of a linear model to a model being saved
+    static void addSections(ModelFileWriter &writer, const double *weights, size_t count, double bias);
+};
+
+
+#endif //SENTIMENTANALYSIS_MODELFILE_H
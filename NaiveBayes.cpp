@@ -1,134 +1,371 @@
 #include "NaiveBayes.h"
+#include "Hash.h"
+#include "StringInterner.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// Contents of SECTION_META in a saved model
+// The model is a bundle: SECTION_BUNDLE holds the number of features and the preprocessing, and the vocabulary
+// sections hold the tokens. The other sections: SECTION_WEIGHTS double logOdds[numFeatures] and
+// SECTION_TOKEN_HASH uint32 buckets[numBuckets].
+struct ModelMeta {
+    uint32_t numBuckets;
+    uint32_t reserved;
+    double laplace;
+    double priorLogOdds;
+    double wordLogOddsOffset;
+};
+
+// Home bucket of a token in a hash table of numBuckets entries, a power of two
+uint32_t bucketOf(std::string_view token, uint32_t numBuckets) {
+    return static_cast<uint32_t>(hashBytes(token.data(), token.size())) & (numBuckets - 1);
+}
+
+}
 
 // Load stopwords from a file and store them in an unordered_set
 void NaiveBayes::loadStopwords(string filename) {
     stopwords = TextPreprocessor::readStopwords("../data/stopwords.txt");
 }
 
-// Calculate the word counts for positive and negative classes in the training dataset
-// Builds a vocabulary and tracks the total number of words for each class
-void NaiveBayes::calculateWordCounts(Dataset &train) {
-    for (auto tokens : train.getData()) {
-        int label = tokens.getLabel();
-        for (const auto &token : tokens.getTokens()) {
-            vocabulary.insert(token); // Add the token to the vocabulary
+// Set the number of training threads; 0 uses all hardware threads
+void NaiveBayes::setNumThreads(int threads) {
+    numThreads = threads > 0 ? threads : ThreadPool::defaultThreadCount();
+}
+
+// Calculate the word counts for positive and negative classes in the training matrix
+// Tracks the total number of words for each class. Map-reduce over the rows: every worker counts its
+// shard into its own flat tables, then the tables are summed with each worker owning a range of features.
+// Counts are whole numbers, so the result is exact and independent of the number of threads.
+void NaiveBayes::calculateWordCounts(const CsrMatrix &train) {
+    struct CountTable {
+        vector<double> positive;
+        vector<double> negative;
+        double positiveWords = 0.0;
+        double negativeWords = 0.0;
+    };
+
+    size_t numFeatures = train.numCols();
+    ThreadPool pool(numThreads);
+    int numShards = static_cast<int>(std::max<size_t>(1, std::min<size_t>(pool.size(), train.numRows())));
+    vector<CountTable> tables(numShards);
+
+    // Map: count each shard of rows
+    pool.run(numShards, [&](int shard) {
+        CountTable &table = tables[shard];
+        table.positive.assign(numFeatures, 0.0);
+        table.negative.assign(numFeatures, 0.0);
+        size_t begin = train.numRows() * shard / numShards;
+        size_t end = train.numRows() * (shard + 1) / numShards;
 
+        for (size_t i = begin; i < end; ++i) {
+            int label = train.label(i);
+            SparseView features = train.row(i);
+            double words = std::accumulate(features.values, features.values + features.nnz, 0.0);
             if (label == 1) {
-                wordCountPositive[token]++;
-                totalPositiveWords++;
+                axpy(1.0, features, table.positive);
+                table.positiveWords += words;
             } else if (label == 0) {
-                wordCountNegative[token]++;
-                totalNegativeWords++;
+                axpy(1.0, features, table.negative);
+                table.negativeWords += words;
             }
         }
-    }
-}
-
-// Calculate the likelihood of each word given the class (positive/negative)
-// Applies Laplace smoothing to handle words that may not be in the training data
-unordered_map<string, double> NaiveBayes::calculateLikelihood(unordered_map<string, int> wordCount, int totalWords, double laplacian_smoothing) {
-    unordered_map<string, double> likelihood;
-    double vocabulary_size = vocabulary.size();
-
-    for (auto item : wordCount) {
-        string token = item.first;
-        double count = item.second;
-
-        likelihood[token] = (count + laplacian_smoothing) / (totalWords + vocabulary_size * laplacian_smoothing);
-    }
+    });
 
-    // Ensure all vocabulary words are in the likelihood map
-    for (const auto &token : vocabulary) {
-        if (likelihood.find(token) == likelihood.end()) {
-            likelihood[token] = laplacian_smoothing / (totalWords + vocabulary_size * laplacian_smoothing);
+    // Reduce: sum the tables, one range of features per worker
+    wordCountPositive.assign(numFeatures, 0.0);
+    wordCountNegative.assign(numFeatures, 0.0);
+    pool.run(numShards, [&](int part) {
+        size_t begin = numFeatures * part / numShards;
+        size_t end = numFeatures * (part + 1) / numShards;
+        for (const CountTable &table : tables) {
+            for (size_t feature = begin; feature < end; ++feature) {
+                wordCountPositive[feature] += table.positive[feature];
+                wordCountNegative[feature] += table.negative[feature];
+            }
         }
+    });
+    for (const CountTable &table : tables) {
+        totalPositiveWords += table.positiveWords;
+        totalNegativeWords += table.negativeWords;
     }
-
-    return likelihood;
 }
 
-// Convert the likelihoods to log-likelihoods to avoid numerical underflow issues
-// This is done because probabilities can become very small, leading to potential precision problems
-unordered_map<string, double> NaiveBayes::calculateLogLikelihood(unordered_map<string, double> likelihood) {
-    unordered_map<string, double> log_likelihood;
-
-    for (auto item : likelihood) {
-        string token = item.first;
-        double prob = item.second;
-        log_likelihood[token] = log(prob);
+// Compute the log-odds of every word from the class counts
+// With Laplace smoothing, P(w|c) = (count(w, c) + laplace) / (total words in c + vocabulary size * laplace).
+// The denominators are the same for every word, so they are kept out of the table (see updateClassTerms)
+void NaiveBayes::compile() {
+    logOdds.resize(wordCountPositive.size());
+    for (size_t feature = 0; feature < logOdds.size(); ++feature) {
+        logOdds[feature] = log(wordCountPositive[feature] + laplace) - log(wordCountNegative[feature] + laplace);
     }
-    return log_likelihood;
+    updateClassTerms();
 }
 
-// Calculate the prior probabilities for positive and negative classes based on the dataset
-// The prior is the probability of each class without any additional information
-void NaiveBayes::calculateLogPrior(Dataset &dataset) {
-    int total_tweets = dataset.getData().size();
-    int positive_tweets = count_if(dataset.getData().begin(), dataset.getData().end(),
-                                   [](const DSText &text) { return text.getLabel() == 1; });
-    int negative_tweets = count_if(dataset.getData().begin(), dataset.getData().end(),
-                                   [](const DSText &text) { return text.getLabel() == 0; });
+// Recompute the prior log-odds and the shared smoothing denominator term from the class totals
+void NaiveBayes::updateClassTerms() {
+    double vocabulary_size = wordCountPositive.size();
+    wordLogOddsOffset = log(totalNegativeWords + vocabulary_size * laplace) - log(totalPositiveWords + vocabulary_size * laplace);
+    priorLogOdds = log(positiveDocuments) - log(negativeDocuments);
+}
 
-    log_prior_positive = log(static_cast<double>(positive_tweets) / total_tweets);
-    log_prior_negative = log(static_cast<double>(negative_tweets) / total_tweets);
+// Count the samples of each class; the prior is the probability of each class without any additional information
+void NaiveBayes::calculateLogPrior(const CsrMatrix &dataset) {
+    const auto &labels = dataset.getLabels();
+    positiveDocuments = count(labels.begin(), labels.end(), 1);
+    negativeDocuments = count(labels.begin(), labels.end(), 0);
 }
 
-// Train the Naive Bayes model by calculating word counts, likelihoods, and priors
+// Train the Naive Bayes model by calculating word counts and priors, then compiling the log-odds table
 // Uses Laplace smoothing to handle cases where a word is not observed in a class
-void NaiveBayes::train(Dataset &train, double laplace) {
+void NaiveBayes::train(const CsrMatrix &train, const Vocabulary &vocabulary, double laplace) {
+    modelFile.close();
+    this->vocabulary = vocabulary;
+    this->laplace = laplace;
     totalPositiveWords = 0;
     totalNegativeWords = 0;
 
     calculateWordCounts(train);
-    auto likelihood_positive = calculateLikelihood(wordCountPositive, totalPositiveWords, laplace);
-    auto likelihood_negative = calculateLikelihood(wordCountNegative, totalNegativeWords, laplace);
+    calculateLogPrior(train);
+    compile();
+}
 
-    log_likelihood_positive = calculateLogLikelihood(likelihood_positive);
-    log_likelihood_negative = calculateLogLikelihood(likelihood_negative);
+// Add one labeled sample to the counts and refresh only the log-odds of its words
+void NaiveBayes::update(TokenView tokens, int label) {
+    if (label != 0 && label != 1) {
+        return;
+    }
+    if (modelFile.isOpen()) {
+        std::cerr << "A model loaded from file cannot be updated" << std::endl;
+        return;
+    }
+    vector<double> &wordCount = label == 1 ? wordCountPositive : wordCountNegative;
+    double &totalWords = label == 1 ? totalPositiveWords : totalNegativeWords;
 
-    calculateLogPrior(train);
+    for (uint32_t token : tokens) {
+        int feature = vocabulary.featureId(token);
+        if (feature >= 0) {
+            wordCount[feature] += 1.0;
+            totalWords += 1.0;
+            logOdds[feature] = log(wordCountPositive[feature] + laplace) - log(wordCountNegative[feature] + laplace);
+        }
+    }
+    (label == 1 ? positiveDocuments : negativeDocuments) += 1.0;
+    updateClassTerms();
+}
+
+// Add every sample of a dataset to the model
+void NaiveBayes::partialFit(Dataset &dataset) {
+    for (const DSText &sample : dataset.getData()) {
+        update(sample.getTokens(), sample.getLabel());
+    }
 }
 
-// Predict the sentiment of a given text by calculating the log-probabilities for each class
-// The class with the higher log-probability is chosen as the prediction
+// Predict the sentiment of a given text from the log-odds of its words
+// A positive total means the positive class has the higher log-probability
 int NaiveBayes::predict(const std::string &text) {
     vector<string> tokens = TextPreprocessor::preprocess(text, stopwords);
 
-    double positive_score = log_prior_positive;
-    double negative_score = log_prior_negative;
-
-    // Sum log-likelihoods for each word in the text
+    // Sum log-odds for each word in the text; words outside the vocabulary are ignored
+    const double *table = logOddsTable();
+    double score = priorLogOdds;
     for (const auto &token : tokens) {
-        if (log_likelihood_positive.find(token) != log_likelihood_positive.end()) {
-            positive_score += log_likelihood_positive[token];
+        int feature = featureId(token);
+        if (feature >= 0) {
+            score += table[feature] + wordLogOddsOffset;
         }
+    }
 
-        if (log_likelihood_negative.find(token) != log_likelihood_negative.end()) {
-            negative_score += log_likelihood_negative[token];
+    return score >= 0.0 ? 1 : 0;
+}
+
+// Predict the sentiment of a preprocessed sample from its interned token ids
+// Skips the string round trip of predict(text), so the tokens are not stemmed and filtered a second time
+int NaiveBayes::predictTokens(TokenView tokens) const {
+    const double *table = logOddsTable();
+    double score = priorLogOdds;
+    for (uint32_t token : tokens) {
+        int feature = featureId(token);
+        if (feature >= 0) {
+            score += table[feature] + wordLogOddsOffset;
         }
     }
 
-    // Return the label with the higher score
-    return positive_score >= negative_score ? 1 : 0;
+    return score >= 0.0 ? 1 : 0;
+}
+
+// Predict the sentiment of every sample in order
+vector<int> NaiveBayes::predictBatch(const vector<DSText> &samples) const {
+    vector<int> predictions;
+    predictions.reserve(samples.size());
+    for (const DSText &sample : samples) {
+        predictions.push_back(predictTokens(sample.getTokens()));
+    }
+    return predictions;
+}
+
+// Predict the sentiment of one row of a CSR matrix built over the training vocabulary
+int NaiveBayes::predictRow(const CsrMatrix &dataset, size_t row) const {
+    SparseView features = dataset.row(row);
+    double words = std::accumulate(features.values, features.values + features.nnz, 0.0);
+    return priorLogOdds + dot(features, logOdds) + words * wordLogOddsOffset >= 0.0 ? 1 : 0;
 }
 
 // Evaluate the accuracy of the model on a given dataset
 // Compares predicted labels with true labels to compute the accuracy
 double NaiveBayes::evaluate(Dataset &dataset) {
-    int correct_predictions = 0;
-    int total_predictions = 0;
+    const vector<DSText> &samples = dataset.getData();
+    vector<int> predictions = predictBatch(samples);
 
-    for (const DSText &text : dataset.getData()) {
-        std::string combined_text;
-        for (const std::string &token : text.getTokens()) {
-            combined_text += token + " ";
+    int correct_predictions = 0;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        if (predictions[i] == samples[i].getLabel()) {
+            correct_predictions++;
         }
-        int predicted_label = predict(combined_text);
-        if (predicted_label == text.getLabel()) {
+    }
+
+    return 100 * static_cast<double>(correct_predictions) / samples.size();
+}
+
+// Evaluate the accuracy of the model on a CSR matrix built over the training vocabulary
+double NaiveBayes::evaluate(const CsrMatrix &dataset) {
+    if (modelFile.isOpen()) {
+        std::cerr << "A model loaded from file must be evaluated on a Dataset, since the matrix columns follow another vocabulary" << std::endl;
+        return 0.0;
+    }
+    int correct_predictions = 0;
+
+    for (size_t i = 0; i < dataset.numRows(); ++i) {
+        if (predictRow(dataset, i) == dataset.label(i)) {
             correct_predictions++;
         }
-        total_predictions++;
     }
 
-    return 100 * static_cast<double>(correct_predictions) / total_predictions;
+    return 100 * static_cast<double>(correct_predictions) / dataset.numRows();
+}
+
+// Feature id of a token string; a mapped model probes the hash table stored in the file
+int NaiveBayes::featureId(std::string_view token) const {
+    if (!modelFile.isOpen()) {
+        return vocabulary.featureId(token);
+    }
+
+    uint32_t mask = numMappedBuckets - 1;
+    uint32_t bucket = bucketOf(token, numMappedBuckets);
+    for (uint32_t probes = 0; probes < numMappedBuckets; ++probes, bucket = (bucket + 1) & mask) {
+        uint32_t entry = mappedBuckets[bucket];
+        if (entry == 0 || entry > numMappedFeatures) {
+            return -1;
+        }
+        uint32_t begin = mappedStringOffsets[entry - 1];
+        uint32_t end = mappedStringOffsets[entry];
+        if (begin <= end && end <= mappedStringBytes && token == std::string_view(mappedStrings + begin, end - begin)) {
+            return static_cast<int>(entry - 1);
+        }
+    }
+    return -1;
+}
+
+// Feature id of an interned token
+int NaiveBayes::featureId(uint32_t token) const {
+    if (!modelFile.isOpen()) {
+        return vocabulary.featureId(token);
+    }
+    return featureId(StringInterner::global().str(token));
+}
+
+// Save the compiled model to a binary file
+// Tokens are indexed by an open-addressing hash table at most half full, so a mapped model needs no setup
+void NaiveBayes::saveWeights(const std::string &filename, uint64_t stopwordsHash) const {
+    ModelFileWriter writer(ModelType::NaiveBayes);
+    ModelMeta meta{numMappedBuckets, 0, laplace, priorLogOdds, wordLogOddsOffset};
+
+    // A mapped model already holds every section. They are written straight from the mapping, which is safe
+    // even when filename is the mapped file: the writer replaces the file by renaming and never truncates it.
+    if (modelFile.isOpen()) {
+        ModelBundle::addHeader(writer, numMappedFeatures, stopwordsHash);
+        writer.add(SECTION_TOKEN_OFFSETS, mappedStringOffsets, (numMappedFeatures + 1) * sizeof(uint32_t));
+        writer.add(SECTION_TOKENS, mappedStrings, mappedStringBytes);
+        writer.addValue(SECTION_META, meta);
+        writer.add(SECTION_WEIGHTS, mappedLogOdds, numMappedFeatures * sizeof(double));
+        writer.add(SECTION_TOKEN_HASH, mappedBuckets, numMappedBuckets * sizeof(uint32_t));
+        if (writer.write(filename)) {
+            std::cout << "Saved " << numMappedFeatures << " words to " << filename << std::endl;
+        }
+        return;
+    }
+
+    uint32_t numFeatures = static_cast<uint32_t>(logOdds.size());
+    meta.numBuckets = 1;
+    while (meta.numBuckets < 2 * numFeatures) {
+        meta.numBuckets <<= 1;
+    }
+
+    vector<uint32_t> buckets(meta.numBuckets, 0);
+    for (uint32_t feature = 0; feature < numFeatures; ++feature) {
+        uint32_t bucket = bucketOf(vocabulary.token(static_cast<int>(feature)), meta.numBuckets);
+        while (buckets[bucket] != 0) {
+            bucket = (bucket + 1) & (meta.numBuckets - 1);
+        }
+        buckets[bucket] = feature + 1;
+    }
+
+    ModelBundle::addVocabulary(writer, vocabulary, stopwordsHash);
+    writer.addValue(SECTION_META, meta);
+    writer.add(SECTION_WEIGHTS, logOdds);
+    writer.add(SECTION_TOKEN_HASH, buckets);
+    if (writer.write(filename)) {
+        std::cout << "Saved " << numFeatures << " words to " << filename << std::endl;
+    }
+}
+
+// Load a model saved by saveWeights by mapping the file
+// The bundle header must match this process's preprocessing. Beyond that only the section sizes are checked
+// here; entries are bounds-checked as they are read.
+bool NaiveBayes::loadWeights(const std::string &filename, uint64_t stopwordsHash, bool verifyChecksums) {
+    ModelFile file;
+    uint32_t numFeatures = 0;
+    if (!file.open(filename, ModelType::NaiveBayes, verifyChecksums) || !ModelBundle::readHeader(file, stopwordsHash, numFeatures)) {
+        return false;
+    }
+
+    ModelMeta meta{};
+    const double *values = nullptr;
+    const uint32_t *stringOffsets = nullptr;
+    const uint32_t *buckets = nullptr;
+    size_t stringBytes = 0;
+    const char *strings = file.section(SECTION_TOKENS, stringBytes);
+    if (file.value(SECTION_META, meta)) {
+        values = file.array<double>(SECTION_WEIGHTS, numFeatures);
+        stringOffsets = file.array<uint32_t>(SECTION_TOKEN_OFFSETS, static_cast<size_t>(numFeatures) + 1);
+        buckets = file.array<uint32_t>(SECTION_TOKEN_HASH, meta.numBuckets);
+    }
+    bool powerOfTwo = meta.numBuckets != 0 && (meta.numBuckets & (meta.numBuckets - 1)) == 0;
+    if (!powerOfTwo || values == nullptr || stringOffsets == nullptr || buckets == nullptr || strings == nullptr
+        || stringBytes > UINT32_MAX) {
+        std::cerr << "Corrupt Naive Bayes model file: " << filename << std::endl;
+        return false;
+    }
+
+    mappedLogOdds = values;
+    mappedStringOffsets = stringOffsets;
+    mappedBuckets = buckets;
+    mappedStrings = strings;
+    numMappedFeatures = numFeatures;
+    numMappedBuckets = meta.numBuckets;
+    mappedStringBytes = static_cast<uint32_t>(stringBytes);
+
+    laplace = meta.laplace;
+    priorLogOdds = meta.priorLogOdds;
+    wordLogOddsOffset = meta.wordLogOddsOffset;
+    modelFile = std::move(file);
+
+    // The mapped model replaces any trained state
+    vocabulary = Vocabulary();
+    wordCountPositive.clear();
+    wordCountNegative.clear();
+    logOdds.clear();
+    return true;
 }
@@ -2,6 +2,9 @@
 #define SENTIMENTANALYSIS_NAIVEBAYES_H
 
 #include "Twitter.h"
+#include "Vocabulary.h"
+#include "ThreadPool.h"
+#include "ModelBundle.h"
 #include <unordered_map>
 #include <unordered_set>
 #include <math.h>
@@ -10,39 +13,86 @@ class NaiveBayes {
 private:
 
     unordered_set<string> stopwords;
-    unordered_map<string, int> wordCountPositive;
-    unordered_map<string, int> wordCountNegative;
-    unordered_map<string, int> totalWordCount;
-    unordered_set<string> vocabulary;
+    Vocabulary vocabulary; // Feature space of the training matrix, kept for predicting raw text
+    vector<double> wordCountPositive;      // Indexed by feature id
+    vector<double> wordCountNegative;
 
-    int totalPositiveWords;
-    int totalNegativeWords;
+    int numThreads = ThreadPool::defaultThreadCount(); // Workers counting words during training
 
-    double log_prior_positive;
-    double log_prior_negative;
+    double totalPositiveWords = 0.0;
+    double totalNegativeWords = 0.0;
+    double positiveDocuments = 0.0;
+    double negativeDocuments = 0.0;
+    double laplace = 1.0;
 
-    std::unordered_map<std::string, double> log_likelihood_positive;
-    std::unordered_map<std::string, double> log_likelihood_negative;
+    // Compiled model. With Laplace smoothing, log(P(w|pos) / P(w|neg)) splits into a per-word term
+    // log((count(w, pos) + laplace) / (count(w, neg) + laplace)) and a term shared by every word that only
+    // depends on the class totals. A sample is positive when priorLogOdds plus, for each in-vocabulary token,
+    // logOdds[feature] + wordLogOddsOffset is >= 0.
+    vector<double> logOdds;         // Per-word term, indexed by feature id
+    double wordLogOddsOffset = 0.0; // Shared term: log((totalNeg + V * laplace) / (totalPos + V * laplace))
+    double priorLogOdds = 0.0;      // log(P(pos) / P(neg))
 
-    void calculateWordCounts(Dataset &train);
+    // Model file mapped by loadWeights. While it is open, its string table and log-odds table are used in
+    // place of the vocabulary and logOdds, so nothing is copied or rebuilt at load time.
+    ModelFile modelFile;
+    const double *mappedLogOdds = nullptr;
+    const uint32_t *mappedStringOffsets = nullptr; // Feature id to start of its token in mappedStrings
+    const uint32_t *mappedBuckets = nullptr;       // Open-addressing hash table of feature id + 1, 0 if empty
+    const char *mappedStrings = nullptr;
+    uint32_t numMappedFeatures = 0;
+    uint32_t numMappedBuckets = 0;
+    uint32_t mappedStringBytes = 0;
 
-    unordered_map<string, double>
-    calculateLikelihood(unordered_map<string, int> wordCount, int totalWords, double laplacian_smoothing = 1.0);
+    void calculateWordCounts(const CsrMatrix &train);
 
-    static unordered_map<string, double> calculateLogLikelihood(unordered_map<string, double> likelihood);
+    void calculateLogPrior(const CsrMatrix &dataset);
 
-    void calculateLogPrior(Dataset &dataset);
+    // Fold the smoothed class-conditional likelihoods into the log-odds table in one pass
+    void compile();
+
+    // Recompute the terms that depend only on the class totals, in O(1)
+    void updateClassTerms();
+
+    int predictRow(const CsrMatrix &dataset, size_t row) const;
+
+    // Feature id of a token in whichever model is active (trained or mapped), or -1 if it is unknown
+    int featureId(std::string_view token) const;
+    int featureId(uint32_t token) const;
+    const double *logOddsTable() const { return modelFile.isOpen() ? mappedLogOdds : logOdds.data(); }
 
 
 public:
 
     void loadStopwords(string filename);
 
-    void train(Dataset &train, double laplace = 1.0);
+    // Set the number of training threads; 0 uses all hardware threads
+    void setNumThreads(int threads);
+
+    void train(const CsrMatrix &train, const Vocabulary &vocabulary, double laplace = 1.0);
 
     int predict(const std::string &text);
 
+    // Predict already preprocessed samples directly from their interned token ids
+    int predictTokens(TokenView tokens) const;
+    vector<int> predictBatch(const vector<DSText> &samples) const;
+
+    // Fold new labeled samples into a trained model without retraining
+    // Costs O(tokens): only the counts and log-odds of the words seen change. The vocabulary stays frozen,
+    // so words outside it are ignored.
+    void update(TokenView tokens, int label);
+    void partialFit(Dataset &dataset);
+
     double evaluate(Dataset &dataset);
+    double evaluate(const CsrMatrix &dataset);
+
+    // Save the vocabulary, the log-odds table and the priors in a layout that loadWeights maps in place
+    // The file is a bundle that records the preprocessing version and the stopwords it was trained with
+    void saveWeights(const std::string &filename, uint64_t stopwordsHash) const;
+    // Map a saved model instead of reading it: without verifyChecksums loading is O(1) and pages are read on
+    // first use. The bundle must match stopwordsHash and this program's preprocessing. A loaded model predicts
+    // but cannot be updated, since the file holds no counts.
+    bool loadWeights(const std::string &filename, uint64_t stopwordsHash, bool verifyChecksums = true);
 };
 
 
@@ -6,28 +6,51 @@
 #include <cstdlib>
 #include <random>
 
+namespace {
+
+// Contents of SECTION_META in a saved model
+struct ModelMeta {
+    int32_t inputSize;
+    int32_t hiddenSize;
+};
+
+}
+
 
 // Constructor initializes the structure and randomizes weights and biases
-NeuralNetwork::NeuralNetwork(int inputSize, int hiddenSize)
-        : inputSize(inputSize), hiddenSize(hiddenSize), biasOutput(0.0) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+NeuralNetwork::NeuralNetwork(int inputSize, int hiddenSize, unsigned int seed)
+        : inputSize(inputSize), hiddenSize(hiddenSize) {
+    std::mt19937 gen(seed);
     std::normal_distribution<> d(0, 1);
 
-    weightsInputHidden.resize(hiddenSize, std::vector<double>(inputSize));
-    biasHidden.resize(hiddenSize);
-    weightsHiddenOutput.resize(hiddenSize);
+    allocateParameters();
 
+    double* inputHidden = parameterData();
+    for (size_t j = 0; j < static_cast<size_t>(inputSize) * hiddenSize; ++j) {
+        inputHidden[j] = d(gen) * sqrt(2.0 / inputSize); // He initialization
+    }
     for (int i = 0; i < hiddenSize; ++i) {
-        for (int j = 0; j < inputSize; ++j) {
-            weightsInputHidden[i][j] = d(gen) * sqrt(2.0 / inputSize); // He initialization
-        }
-        biasHidden[i] = 0.0;
-        weightsHiddenOutput[i] = d(gen) * sqrt(2.0 / hiddenSize); // He initialization
+        weightsHiddenOutput()[i] = d(gen) * sqrt(2.0 / hiddenSize); // He initialization
     }
 }
 
 
+// Lay out the sections of the parameter buffer for the current layer sizes, each padded to a whole cache line
+// All parameters start at zero, in owned memory
+void NeuralNetwork::allocateParameters() {
+    biasHiddenOffset = alignedCount(static_cast<size_t>(inputSize) * hiddenSize);
+    weightsHiddenOutputOffset = biasHiddenOffset + alignedCount(hiddenSize);
+    biasOutputOffset = weightsHiddenOutputOffset + alignedCount(hiddenSize);
+    modelFile.close();
+    mappedParameters = nullptr;
+    parameters.assign(parameterCount(inputSize, hiddenSize), 0.0);
+}
+
+// Number of doubles in the parameter buffer of a network with the given layer sizes, matching allocateParameters
+size_t NeuralNetwork::parameterCount(int inputSize, int hiddenSize) {
+    return alignedCount(static_cast<size_t>(inputSize) * hiddenSize) + 2 * alignedCount(hiddenSize) + alignedCount(1);
+}
+
 // Sigmoid activation function
 double NeuralNetwork::sigmoid(double x) {
     return 1.0 / (1.0 + std::exp(-x));
@@ -49,213 +72,373 @@ double NeuralNetwork::reluDerivative(double x) {
 }
 
 // Forward pass through the network
-// Computes the output of the network given an input vector
-double NeuralNetwork::forward(const std::vector<double>& input, std::vector<double>& hiddenLayerOutput) {
+// Computes the output of the network given a sparse input vector.
+// The input layer works as an embedding bag: only the weight rows of the tokens present are summed.
+double NeuralNetwork::forward(const SparseView& input, std::vector<double>& hiddenLayerOutput) {
     // Compute hidden layer output
+    std::copy(biasHidden(), biasHidden() + hiddenSize, hiddenLayerOutput.begin());
+    gemvSparse(weightsInputHidden(), input, hiddenLayerOutput.data());
     for (int i = 0; i < hiddenSize; ++i) {
-        hiddenLayerOutput[i] = biasHidden[i];
-        for (int j = 0; j < inputSize; ++j) {
-            hiddenLayerOutput[i] += input[j] * weightsInputHidden[i][j];
-        }
         hiddenLayerOutput[i] = relu(hiddenLayerOutput[i]);
     }
 
     // Compute output layer output
-    double output = biasOutput;
-    for (int i = 0; i < hiddenSize; ++i) {
-        output += hiddenLayerOutput[i] * weightsHiddenOutput[i];
-    }
+    double output = biasOutput() + dot(hiddenSize, hiddenLayerOutput.data(), weightsHiddenOutput());
     return sigmoid(output);
 }
 
-// Backward propagation step to update weights and biases
-// Takes learningRate as a parameter to adjust the extent of updates
-void NeuralNetwork::backward(const std::vector<double>& input, const std::vector<double>& hiddenLayerOutput, double output, double target, double learningRate) {
-    // Compute output layer error
-    double outputError = output - target;
-    double outputGradient = outputError * sigmoidDerivative(output);
+// Resize the mini-batch buffers for the given batch and hidden layer sizes and number of worker threads
+void NeuralNetwork::BatchWorkspace::resize(int batchSize, int hiddenSize, int numWorkers) {
+    hidden.assign(static_cast<size_t>(batchSize) * hiddenSize, 0.0);
+    hiddenDelta.assign(static_cast<size_t>(batchSize) * hiddenSize, 0.0);
+    output.assign(batchSize, 0.0);
+    outputDelta.assign(batchSize, 0.0);
+    gradientHiddenOutput.assign(hiddenSize, 0.0);
+    gradientBiasHidden.assign(hiddenSize, 0.0);
+    outgoing.resize(numWorkers);
+}
 
-    // Update weights and bias for output layer
-    for (int i = 0; i < hiddenSize; ++i) {
-        weightsHiddenOutput[i] -= learningRate * outputGradient * hiddenLayerOutput[i];
+// Forward pass over the rows of a workspace's share of the batch
+// Fills the share's hidden activations and outputs and returns the summed squared error
+double NeuralNetwork::forwardBatch(const CsrMatrix& data, BatchWorkspace& workspace) {
+    MatrixView inputHidden = weightsInputHidden();
+    MatrixView hidden = MatrixView::rowMajor(workspace.hidden.data(), workspace.count, hiddenSize);
+
+    // Hidden layer: sparse batch times the input-hidden weights, one embedding bag per row
+    for (size_t b = 0; b < workspace.count; ++b) {
+        double* row = hidden.row(b);
+        std::copy(biasHidden(), biasHidden() + hiddenSize, row);
+        gemvSparse(inputHidden, data.row(workspace.begin + b), row);
+        for (int i = 0; i < hiddenSize; ++i) {
+            row[i] = relu(row[i]);
+        }
     }
-    biasOutput -= learningRate * outputGradient;
 
-    // Backpropagate error to hidden layer
-    std::vector<double> hiddenErrors(hiddenSize);
-    for (int i = 0; i < hiddenSize; ++i) {
-        hiddenErrors[i] = outputGradient * weightsHiddenOutput[i] * reluDerivative(hiddenLayerOutput[i]);
+    // Output layer: one matrix-vector product for the whole share
+    std::fill(workspace.output.begin(), workspace.output.begin() + workspace.count, biasOutput());
+    gemv(hidden, weightsHiddenOutput(), workspace.output.data());
+
+    double loss = 0.0;
+    for (size_t b = 0; b < workspace.count; ++b) {
+        workspace.output[b] = sigmoid(workspace.output[b]);
+        double error = workspace.output[b] - data.label(workspace.begin + b);
+        loss += error * error; // Mean Squared Error
     }
+    return loss;
+}
 
-    // Update weights and biases for hidden layer
-    for (int i = 0; i < hiddenSize; ++i) {
-        for (int j = 0; j < inputSize; ++j) {
-            weightsInputHidden[i][j] -= learningRate * hiddenErrors[i] * input[j];
+// Backward pass over a share whose forward pass is in the workspace
+// Computes the error terms and the dense gradients, multiplied by scale (one over the full batch size)
+void NeuralNetwork::backwardBatch(const CsrMatrix& data, BatchWorkspace& workspace, double scale) {
+    size_t count = workspace.count;
+    MatrixView hidden = MatrixView::rowMajor(workspace.hidden.data(), count, hiddenSize);
+    MatrixView hiddenDelta = MatrixView::rowMajor(workspace.hiddenDelta.data(), count, hiddenSize);
+
+    // Output layer error terms
+    workspace.gradientBiasOutput = 0.0;
+    for (size_t b = 0; b < count; ++b) {
+        double output = workspace.output[b];
+        workspace.outputDelta[b] = scale * (output - data.label(workspace.begin + b)) * sigmoidDerivative(output);
+        workspace.gradientBiasOutput += workspace.outputDelta[b];
+    }
+
+    // Hidden layer error terms: rank-1 product of the output errors and output weights, masked by ReLU
+    std::fill(workspace.hiddenDelta.begin(), workspace.hiddenDelta.begin() + count * hiddenSize, 0.0);
+    ger(hiddenDelta, 1.0, workspace.outputDelta.data(), weightsHiddenOutput());
+    for (size_t b = 0; b < count; ++b) {
+        const double* activation = hidden.row(b);
+        double* delta = hiddenDelta.row(b);
+        for (int i = 0; i < hiddenSize; ++i) {
+            delta[i] *= reluDerivative(activation[i]);
         }
-        biasHidden[i] -= learningRate * hiddenErrors[i];
+    }
+
+    // Dense gradients: hidden-output weights and the hidden biases
+    std::fill(workspace.gradientHiddenOutput.begin(), workspace.gradientHiddenOutput.end(), 0.0);
+    gemvTransposed(hidden, workspace.outputDelta.data(), workspace.gradientHiddenOutput.data());
+    std::fill(workspace.gradientBiasHidden.begin(), workspace.gradientBiasHidden.end(), 0.0);
+    for (size_t b = 0; b < count; ++b) {
+        axpy(hiddenSize, 1.0, hiddenDelta.row(b), workspace.gradientBiasHidden.data());
+    }
+}
+
+// Sort the input-hidden gradient contributions of a share by the thread that owns their weight rows
+// Thread t owns the features in [inputSize * t / numShards, inputSize * (t + 1) / numShards). Row indices are
+// sorted, so one pass per row suffices and no thread has to search the rows it does not own.
+void NeuralNetwork::routeInputHiddenGradients(const CsrMatrix& data, BatchWorkspace& workspace, int numShards) {
+    for (int part = 0; part < numShards; ++part) {
+        workspace.outgoing[part].clear();
+    }
+    for (size_t b = 0; b < workspace.count; ++b) {
+        SparseView input = data.row(workspace.begin + b);
+        const double* delta = &workspace.hiddenDelta[b * hiddenSize];
+        int owner = 0;
+        size_t ownerEnd = static_cast<size_t>(inputSize) / numShards;
+        for (size_t k = 0; k < input.nnz; ++k) {
+            while (input.indices[k] >= ownerEnd) {
+                ++owner;
+                ownerEnd = static_cast<size_t>(inputSize) * (owner + 1) / numShards;
+            }
+            workspace.outgoing[owner].push_back({input.indices[k], input.values[k], delta});
+        }
+    }
+}
+
+// Apply the input-hidden gradient contributions routed to thread `part` by every share
+// Each feature range is owned by one thread and its rows are updated in batch order, so no update races.
+// With an optimizer, a row's contributions from the whole batch are summed first so it takes one step per batch.
+void NeuralNetwork::applyInputHiddenGradients(const CsrMatrix& data, const std::vector<BatchWorkspace>& workspaces, int numShards,
+                                              int part, double learningRate, RowScratch& scratch) {
+    MatrixView inputHidden = weightsInputHidden();
+    auto forEachContribution = [&](auto&& visit) {
+        if (numShards > 1) {
+            for (int shard = 0; shard < numShards; ++shard) {
+                for (const RowContribution& contribution : workspaces[shard].outgoing[part]) {
+                    visit(contribution);
+                }
+            }
+            return;
+        }
+        // A single thread owns every row, so the rows are walked directly instead of being routed
+        const BatchWorkspace& workspace = workspaces[0];
+        for (size_t b = 0; b < workspace.count; ++b) {
+            SparseView input = data.row(workspace.begin + b);
+            const double* delta = &workspace.hiddenDelta[b * hiddenSize];
+            for (size_t k = 0; k < input.nnz; ++k) {
+                visit(RowContribution{input.indices[k], input.values[k], delta});
+            }
+        }
+    };
+
+    if (!optimizer) {
+        forEachContribution([&](const RowContribution& contribution) {
+            axpy(hiddenSize, -learningRate * contribution.value, contribution.delta, inputHidden.row(contribution.feature));
+        });
+        return;
+    }
+
+    // Group the contributions by row, keeping batch order within a row so the sums are deterministic
+    scratch.contributions.clear();
+    forEachContribution([&](const RowContribution& contribution) { scratch.contributions.push_back(contribution); });
+    std::stable_sort(scratch.contributions.begin(), scratch.contributions.end(),
+                     [](const RowContribution& a, const RowContribution& b) { return a.feature < b.feature; });
+    scratch.gradient.resize(hiddenSize);
+    for (size_t first = 0; first < scratch.contributions.size();) {
+        uint32_t feature = scratch.contributions[first].feature;
+        std::fill(scratch.gradient.begin(), scratch.gradient.end(), 0.0);
+        size_t last = first;
+        for (; last < scratch.contributions.size() && scratch.contributions[last].feature == feature; ++last) {
+            axpy(hiddenSize, scratch.contributions[last].value, scratch.contributions[last].delta, scratch.gradient.data());
+        }
+        optimizer->updateRange(static_cast<size_t>(feature) * hiddenSize, hiddenSize, scratch.gradient.data(),
+                               learningRate, inputHidden.row(feature));
+        first = last;
+    }
+}
+
+// Sum the dense gradients of all shares for thread `part`'s range of hidden units and apply them in one step
+// The shares are added in order into workspaces[0], so the result is deterministic for a given number of shards;
+// thread 0 also takes the output bias
+void NeuralNetwork::applyDenseGradients(std::vector<BatchWorkspace>& workspaces, int numShards, int part, double learningRate) {
+    size_t begin = static_cast<size_t>(hiddenSize) * part / numShards;
+    size_t count = static_cast<size_t>(hiddenSize) * (part + 1) / numShards - begin;
+    BatchWorkspace& total = workspaces[0];
+    double* gradientBiasHidden = total.gradientBiasHidden.data() + begin;
+    double* gradientHiddenOutput = total.gradientHiddenOutput.data() + begin;
+    for (int shard = 1; shard < numShards; ++shard) {
+        axpy(count, 1.0, workspaces[shard].gradientBiasHidden.data() + begin, gradientBiasHidden);
+        axpy(count, 1.0, workspaces[shard].gradientHiddenOutput.data() + begin, gradientHiddenOutput);
+        if (part == 0) {
+            total.gradientBiasOutput += workspaces[shard].gradientBiasOutput;
+        }
+    }
+
+    if (optimizer) {
+        optimizer->updateRange(biasHiddenOffset + begin, count, gradientBiasHidden, learningRate, biasHidden() + begin);
+        optimizer->updateRange(weightsHiddenOutputOffset + begin, count, gradientHiddenOutput, learningRate, weightsHiddenOutput() + begin);
+        if (part == 0) {
+            optimizer->update(biasOutputOffset, total.gradientBiasOutput, learningRate, biasOutput());
+        }
+        return;
+    }
+    axpy(count, -learningRate, gradientBiasHidden, biasHidden() + begin);
+    axpy(count, -learningRate, gradientHiddenOutput, weightsHiddenOutput() + begin);
+    if (part == 0) {
+        biasOutput() -= learningRate * total.gradientBiasOutput;
     }
 }
 
 // Train the neural network using the training data
-// Iteratively adjusts weights using gradient descent and backpropagation
-void NeuralNetwork::train(Dataset& trainData, std::unordered_map<std::string, int> vocabulary, int epochs, double learningRate, Dataset& devData, bool verbose) {
-    std::vector<std::vector<double>> trainFeatures;
-    std::vector<int> trainLabels;
-
-    // Convert training data to feature vectors
-    for (const auto& sample : trainData.getData()) {
-        trainFeatures.push_back(TextPreprocessor::createFeatureVector(sample.getTokens(), vocabulary));
-        trainLabels.push_back(sample.getLabel());
+// Runs mini-batch gradient descent. Each batch is split into contiguous shares, one per thread, and takes two
+// parallel phases: every thread runs the forward and backward pass of its share and routes its input-hidden
+// gradients to the threads owning the rows; then every thread applies the gradients of its rows and sums and
+// applies its range of the dense gradients.
+void NeuralNetwork::train(const CsrMatrix& trainData, int epochs, double learningRate, const CsrMatrix& devData, bool verbose) {
+    // Every batch costs two pool barriers, so a thread only joins if it gets at least MIN_SHARE_ROWS rows
+    int numWorkers = std::max(1, std::min(numThreads, batchSize / MIN_SHARE_ROWS));
+    ThreadPool pool(numWorkers);
+    int shareSize = (batchSize + numWorkers - 1) / numWorkers;
+
+    std::vector<BatchWorkspace> workspaces(numWorkers);
+    for (BatchWorkspace& workspace : workspaces) {
+        workspace.resize(shareSize, hiddenSize, numWorkers);
+    }
+    std::vector<double> shareLoss(numWorkers);
+    std::vector<RowScratch> rowScratch(numWorkers);
+    if (optimizer) {
+        // State is indexed like the parameter buffer
+        optimizer->reset(parameterCount(inputSize, hiddenSize));
     }
 
     // Training loop over the specified number of epochs
     for (int epoch = 0; epoch < epochs; ++epoch) {
         double totalLoss = 0.0;
 
-        for (size_t i = 0; i < trainFeatures.size(); ++i) {
-            std::vector<double> hiddenLayerOutput(hiddenSize);
-            double output = forward(trainFeatures[i], hiddenLayerOutput);
-            double target = trainLabels[i];
-
-            // Calculate loss (Mean Squared Error)
-            double loss = (output - target) * (output - target);
-            totalLoss += loss;
-
-            // Perform backpropagation
-            backward(trainFeatures[i], hiddenLayerOutput, output, target, learningRate);
-
-//            // Print progress
-//            std::cout << "\rEpoch " << epoch + 1 << "/" << epochs
-//                      << ", Sample " << i + 1 << "/" << trainFeatures.size() << std::flush;
+        for (size_t begin = 0; begin < trainData.numRows(); begin += batchSize) {
+            size_t count = std::min(static_cast<size_t>(batchSize), trainData.numRows() - begin);
+            int numShards = static_cast<int>(std::max<size_t>(1, std::min<size_t>(numWorkers, count / MIN_SHARE_ROWS)));
+
+            // Forward and backward pass of each share into thread-local buffers
+            pool.run(numShards, [&](int shard) {
+                BatchWorkspace& workspace = workspaces[shard];
+                workspace.begin = begin + count * shard / numShards;
+                workspace.count = begin + count * (shard + 1) / numShards - workspace.begin;
+                shareLoss[shard] = forwardBatch(trainData, workspace);
+                backwardBatch(trainData, workspace, 1.0 / count);
+                if (numShards > 1) {
+                    routeInputHiddenGradients(trainData, workspace, numShards);
+                }
+            });
+            if (optimizer) {
+                optimizer->step();
+            }
+
+            // Updates, split by input feature range and by hidden unit range
+            pool.run(numShards, [&](int part) {
+                applyInputHiddenGradients(trainData, workspaces, numShards, part, learningRate, rowScratch[part]);
+                applyDenseGradients(workspaces, numShards, part, learningRate);
+            });
+
+            for (int shard = 0; shard < numShards; ++shard) {
+                totalLoss += shareLoss[shard];
+            }
         }
 
-        totalLoss /= trainFeatures.size();
+        totalLoss /= trainData.numRows();
 
         if (verbose) {
             std::cout << "\nEpoch " << epoch + 1 << ", Loss: " << totalLoss << std::endl;
-            double accuracy = evaluate(devData, vocabulary);
+            double accuracy = evaluate(devData);
             std::cout << "Validation Accuracy: " << accuracy << "%" << std::endl;
         }
     }
 }
 
-// Prediction function for a single input
+// Set the number of samples per gradient step; 1 gives plain per-sample SGD
+void NeuralNetwork::setBatchSize(int size) {
+    batchSize = std::max(size, 1);
+}
+
+// Set the number of training threads; 0 uses all hardware threads
+void NeuralNetwork::setNumThreads(int threads) {
+    numThreads = threads > 0 ? threads : ThreadPool::defaultThreadCount();
+}
+
+// Set the optimizer used by train; pass nullptr to go back to plain SGD
+void NeuralNetwork::setOptimizer(std::unique_ptr<Optimizer> newOptimizer) {
+    optimizer = std::move(newOptimizer);
+}
+
+// Prediction function for a single sparse input
 // Returns 1 for positive and 0 for negative based on the output
-int NeuralNetwork::predict(const std::vector<double>& input) {
+int NeuralNetwork::predict(const SparseView& features) {
     std::vector<double> hiddenLayerOutput(hiddenSize);
-    double output = forward(input, hiddenLayerOutput);
+    double output = forward(features, hiddenLayerOutput);
     return output >= 0.5 ? 1 : 0;
 }
 
 // Evaluate the accuracy of the network on the validation dataset
 // Compares predicted labels with true labels to calculate accuracy
-double NeuralNetwork::evaluate(Dataset& devData, std::unordered_map<std::string, int> vocabulary) {
-    std::vector<std::vector<double>> devFeatures;
-    std::vector<int> devLabels;
-
-    // Convert validation data to feature vectors
-    for (const auto& sample : devData.getData()) {
-        devFeatures.push_back(TextPreprocessor::createFeatureVector(sample.getTokens(), vocabulary));
-        devLabels.push_back(sample.getLabel());
-    }
-
+double NeuralNetwork::evaluate(const CsrMatrix& devData) {
+    std::vector<double> hiddenLayerOutput(hiddenSize);
     int correctPredictions = 0;
 
     // Iterate over all validation samples and make predictions
-    for (size_t i = 0; i < devFeatures.size(); ++i) {
-        int prediction = predict(devFeatures[i]);
-        if (prediction == devLabels[i]) {
+    for (size_t i = 0; i < devData.numRows(); ++i) {
+        int prediction = forward(devData.row(i), hiddenLayerOutput) >= 0.5 ? 1 : 0;
+        if (prediction == devData.label(i)) {
             correctPredictions++;
         }
     }
 
-    double accuracy = 100.0 * correctPredictions / devFeatures.size();
+    double accuracy = 100.0 * correctPredictions / devData.numRows();
 
     return accuracy;
 }
 
 // Save the model weights and biases to a binary file
-// Includes progress indication to inform the user of the saving process
+// The parameter buffer is written in one section, in memory layout
 void NeuralNetwork::saveWeights(const std::string& filename) const {
-    std::ofstream outFile(filename, std::ios::out | std::ios::binary);
-
-    if (!outFile.is_open()) {
-        std::cerr << "Error opening file for saving weights: " << filename << std::endl;
-        return;
+    if (modelWriter().write(filename)) {
+        std::cout << "Model weights saved to " << filename << std::endl;
     }
-
-    // Save model parameters (inputSize, hiddenSize)
-    outFile.write(reinterpret_cast<const char*>(&inputSize), sizeof(inputSize));
-    outFile.write(reinterpret_cast<const char*>(&hiddenSize), sizeof(hiddenSize));
-
-    // Save input-hidden weights
-    for (const auto& row : weightsInputHidden) {
-        for (double weight : row) {
-            outFile.write(reinterpret_cast<const char*>(&weight), sizeof(weight));
-        }
-    }
-
-    // Save hidden biases
-    for (double bias : biasHidden) {
-        outFile.write(reinterpret_cast<const char*>(&bias), sizeof(bias));
-    }
-
-    // Save hidden-output weights
-    for (double weight : weightsHiddenOutput) {
-        outFile.write(reinterpret_cast<const char*>(&weight), sizeof(weight));
-    }
-
-    // Save output bias
-    outFile.write(reinterpret_cast<const char*>(&biasOutput), sizeof(biasOutput));
-
-    outFile.close();
-    std::cout << "Model weights saved to " << filename << std::endl;
 }
 
 // Load model weights and biases from a binary file
-// Includes checks to ensure the model structure matches the saved model
-bool NeuralNetwork::loadWeights(const std::string& filename) {
-    std::ifstream inFile(filename, std::ios::in | std::ios::binary);
+// The network uses the mapped parameter buffer in place. A network built with layer sizes must match the
+// file; one built as NeuralNetwork(0, 0) takes its layer sizes from the file.
+bool NeuralNetwork::loadWeights(const std::string& filename, bool verifyChecksums) {
+    ModelFile file;
+    bool sized = inputSize > 0 || hiddenSize > 0;
+    return file.open(filename, ModelType::NeuralNetwork, verifyChecksums)
+           && useModelFile(std::move(file), sized ? inputSize : -1, sized ? hiddenSize : -1);
+}
 
-    if (!inFile.is_open()) {
-        std::cerr << "Error opening file for loading weights: " << filename << std::endl;
-        return false;
-    }
+// Save the network together with its vocabulary, so it can be used without the training data
+void NeuralNetwork::saveBundle(const std::string& filename, const Vocabulary& vocabulary, uint64_t stopwordsHash) const {
+    ModelBundle::save(filename, modelWriter(), vocabulary, stopwordsHash);
+}
 
-    // Load model parameters and check for consistency
-    int loadedInputSize, loadedHiddenSize;
-    inFile.read(reinterpret_cast<char*>(&loadedInputSize), sizeof(loadedInputSize));
-    inFile.read(reinterpret_cast<char*>(&loadedHiddenSize), sizeof(loadedHiddenSize));
+// Load a bundle saved by saveBundle
+bool NeuralNetwork::loadBundle(const std::string& filename, uint64_t stopwordsHash, Vocabulary& vocabulary, bool verifyChecksums) {
+    return ModelBundle::load(filename, ModelType::NeuralNetwork, stopwordsHash, vocabulary, verifyChecksums,
+                             [this](ModelFile&& file, int expectedInputSize) { return useModelFile(std::move(file), expectedInputSize, -1); });
+}
 
-    if (loadedInputSize != inputSize || loadedHiddenSize != hiddenSize) {
-        std::cerr << "Model parameters do not match: "
-                  << "Expected (inputSize: " << inputSize << ", hiddenSize: " << hiddenSize << "), "
-                  << "but got (inputSize: " << loadedInputSize << ", hiddenSize: " << loadedHiddenSize << ")." << std::endl;
-        inFile.close();
-        return false;
-    }
+// Collect the sections of a saved network: the layer sizes, then the whole parameter buffer
+ModelFileWriter NeuralNetwork::modelWriter() const {
+    ModelFileWriter writer(ModelType::NeuralNetwork);
+    writer.addValue(SECTION_META, ModelMeta{inputSize, hiddenSize});
+    writer.add(SECTION_WEIGHTS, parameterData(), parameterCount(inputSize, hiddenSize) * sizeof(double));
+    return writer;
+}
 
-    // Load input-hidden weights
-    for (auto& row : weightsInputHidden) {
-        for (double& weight : row) {
-            inFile.read(reinterpret_cast<char*>(&weight), sizeof(weight));
-        }
+// Point the network at the parameter buffer of a mapped model file
+// The mapping is copy-on-write, so training can continue on it without copying. Non-negative expected
+// layer sizes must match the file; the network is untouched on failure.
+bool NeuralNetwork::useModelFile(ModelFile&& file, int expectedInputSize, int expectedHiddenSize) {
+    ModelMeta meta{};
+    double* values = nullptr;
+    if (file.value(SECTION_META, meta) && meta.inputSize >= 0 && meta.hiddenSize >= 0) {
+        values = file.array<double>(SECTION_WEIGHTS, parameterCount(meta.inputSize, meta.hiddenSize));
     }
-
-    // Load hidden biases
-    for (double& bias : biasHidden) {
-        inFile.read(reinterpret_cast<char*>(&bias), sizeof(bias));
+    if (values == nullptr) {
+        std::cerr << "Corrupt model file: " << file.name() << std::endl;
+        return false;
     }
-
-    // Load hidden-output weights
-    for (double& weight : weightsHiddenOutput) {
-        inFile.read(reinterpret_cast<char*>(&weight), sizeof(weight));
+    if ((expectedInputSize >= 0 && meta.inputSize != expectedInputSize) || (expectedHiddenSize >= 0 && meta.hiddenSize != expectedHiddenSize)) {
+        std::cerr << "Model parameters do not match: expected inputSize " << expectedInputSize << " and hiddenSize " << expectedHiddenSize
+                  << ", but " << file.name() << " has " << meta.inputSize << " and " << meta.hiddenSize << std::endl;
+        return false;
     }
 
-    // Load output bias
-    inFile.read(reinterpret_cast<char*>(&biasOutput), sizeof(biasOutput));
-
-    inFile.close();
-    std::cout << "Model weights loaded from " << filename << std::endl;
+    inputSize = meta.inputSize;
+    hiddenSize = meta.hiddenSize;
+    biasHiddenOffset = alignedCount(static_cast<size_t>(inputSize) * hiddenSize);
+    weightsHiddenOutputOffset = biasHiddenOffset + alignedCount(hiddenSize);
+    biasOutputOffset = weightsHiddenOutputOffset + alignedCount(hiddenSize);
+    AlignedVector().swap(parameters);
+    mappedParameters = values;
+    modelFile = std::move(file);
     return true;
 }
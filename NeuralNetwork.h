@@ -2,42 +2,116 @@
 #define NEURALNETWORK_H
 
 #include <vector>
+#include <random>
 #include <unordered_map>
 #include <string>
 #include "Dataset.h"
 #include "TextPreprocessor.h"
+#include "DenseKernels.h"
+#include "ThreadPool.h"
+#include "Optimizer.h"
+#include "ModelBundle.h"
 
 class NeuralNetwork {
 private:
-    std::vector<std::vector<double>> weightsInputHidden; // Weights between input and hidden layer
-    std::vector<double> biasHidden;                      // Biases for the hidden layer
-    std::vector<double> weightsHiddenOutput;             // Weights between hidden and output layer
-    double biasOutput;                                   // Bias for the output layer
+    // All parameters live in one aligned buffer, each section starting on a cache line:
+    // input-hidden weights (inputSize x hiddenSize, row j holds token j's hidden weights),
+    // hidden biases, hidden-output weights and the output bias
+    AlignedVector parameters;
+    ModelFile modelFile;                                 // Loaded model file; while it is open it holds the parameter buffer
+    double* mappedParameters = nullptr;
+    size_t biasHiddenOffset;                             // Offset of the hidden biases in parameters
+    size_t weightsHiddenOutputOffset;                    // Offset of the hidden-output weights in parameters
+    size_t biasOutputOffset;                             // Offset of the output bias in parameters
     int inputSize;                                       // Number of input features
     int hiddenSize;                                      // Number of neurons in the hidden layer
+    int batchSize = 1;                                   // Number of samples per gradient step
+    int numThreads = 1;                                  // Worker threads sharing each mini-batch
+    static constexpr int MIN_SHARE_ROWS = 16;            // Smallest share of a mini-batch worth a thread and its barriers
+    std::unique_ptr<Optimizer> optimizer;                // Per-parameter update rule; null for plain SGD
+
+    // One sample's contribution to the gradient of an input-hidden weight row: value * delta
+    struct RowContribution {
+        uint32_t feature;
+        double value;
+        const double* delta;
+    };
+
+    // Buffers for one thread's share of a mini-batch, allocated once per training run and reused for every batch
+    struct BatchWorkspace {
+        size_t begin = 0;                                // First row of the share in the training matrix
+        size_t count = 0;                                // Number of rows in the share
+        AlignedVector hidden;                            // batch x hiddenSize hidden layer activations
+        AlignedVector hiddenDelta;                       // batch x hiddenSize hidden layer error terms
+        AlignedVector output;                            // Network output per sample
+        AlignedVector outputDelta;                       // Output layer error term per sample
+        AlignedVector gradientHiddenOutput;              // Gradient of the hidden-output weights
+        AlignedVector gradientBiasHidden;                // Gradient of the hidden biases
+        double gradientBiasOutput = 0.0;                 // Gradient of the output bias
+        std::vector<std::vector<RowContribution>> outgoing; // Input-hidden contributions, by the thread owning the row
+
+        void resize(int batchSize, int hiddenSize, int numWorkers);
+    };
+
+    // Per-thread scratch for summing each row's gradient over a batch before an optimizer update
+    struct RowScratch {
+        std::vector<RowContribution> contributions;
+        AlignedVector gradient;                          // hiddenSize
+    };
+
+    // Views of the parameter sections
+    double* parameterData() { return modelFile.isOpen() ? mappedParameters : parameters.data(); }
+    const double* parameterData() const { return modelFile.isOpen() ? mappedParameters : parameters.data(); }
+    MatrixView weightsInputHidden() { return MatrixView::rowMajor(parameterData(), inputSize, hiddenSize); }
+    double* biasHidden() { return parameterData() + biasHiddenOffset; }
+    double* weightsHiddenOutput() { return parameterData() + weightsHiddenOutputOffset; }
+    double& biasOutput() { return parameterData()[biasOutputOffset]; }
+
+    void allocateParameters();
+    static size_t parameterCount(int inputSize, int hiddenSize);
+    ModelFileWriter modelWriter() const;
+    bool useModelFile(ModelFile&& file, int expectedInputSize, int expectedHiddenSize);
 
     double sigmoid(double x);
     double sigmoidDerivative(double x);
     double relu(double x);
     double reluDerivative(double x);
-    double forward(const std::vector<double>& input, std::vector<double>& hiddenLayerOutput);
-    void backward(const std::vector<double>& input, const std::vector<double>& hiddenLayerOutput, double output, double target, double learningRate);
+    double forward(const SparseView& input, std::vector<double>& hiddenLayerOutput);
+    double forwardBatch(const CsrMatrix& data, BatchWorkspace& workspace);
+    void backwardBatch(const CsrMatrix& data, BatchWorkspace& workspace, double scale);
+    void routeInputHiddenGradients(const CsrMatrix& data, BatchWorkspace& workspace, int numShards);
+    void applyInputHiddenGradients(const CsrMatrix& data, const std::vector<BatchWorkspace>& workspaces, int numShards, int part,
+                                   double learningRate, RowScratch& scratch);
+    void applyDenseGradients(std::vector<BatchWorkspace>& workspaces, int numShards, int part, double learningRate);
 
 public:
-    NeuralNetwork(int inputSize, int hiddenSize); // Constructor only initializes network structure
+    // Constructor only initializes network structure; a fixed seed makes initialization and training reproducible
+    NeuralNetwork(int inputSize, int hiddenSize, unsigned int seed = std::random_device{}());
 
     // Training function now accepts hyperparameters like learningRate and epochs
-    void train(Dataset& trainData, std::unordered_map<std::string, int> vocabulary, int epochs, double learningRate, Dataset& devData, bool verbose = true);
-    int predict(const std::vector<double>& input);
-    double evaluate(Dataset& devData, std::unordered_map<std::string, int> vocabulary);
+    void train(const CsrMatrix& trainData, int epochs, double learningRate, const CsrMatrix& devData, bool verbose = true);
+    int predict(const SparseView& features);
+    void setBatchSize(int size);
+    void setNumThreads(int threads);
+    // Train with an adaptive optimizer for every layer, including the sparse embedding rows
+    void setOptimizer(std::unique_ptr<Optimizer> newOptimizer);
+    double evaluate(const CsrMatrix& devData);
 
     // Functions for saving and loading weights
     void saveWeights(const std::string& filename) const;
-    bool loadWeights(const std::string& filename);
+    // Loading maps the file in place; verifyChecksums = false skips hashing the parameters, so loading is O(1)
+    bool loadWeights(const std::string& filename, bool verifyChecksums = true);
+
+    // Save or load a self-contained bundle with the vocabulary the input weights are indexed by
+    void saveBundle(const std::string& filename, const Vocabulary& vocabulary, uint64_t stopwordsHash) const;
+    bool loadBundle(const std::string& filename, uint64_t stopwordsHash, Vocabulary& vocabulary, bool verifyChecksums = true);
 
     // Getters for validation purposes
     int getInputSize() const { return inputSize; }
     int getHiddenSize() const { return hiddenSize; }
+
+    // Input-hidden weights as hiddenSize x inputSize, the orientation of the textbook W * x formulation
+    MatrixView getHiddenInputWeights() { return weightsInputHidden().transposed(); }
 };
 
 #endif // NEURALNETWORK_H
@@ -0,0 +1,48 @@
+#include "Optimizer.h"
+
+#include <cmath>
+
+std::unique_ptr<Optimizer> Optimizer::create(OptimizerType type) {
+    switch (type) {
+        case OptimizerType::AdaGrad:
+            return std::make_unique<AdaGradOptimizer>();
+        case OptimizerType::Adam:
+            return std::make_unique<AdamOptimizer>();
+        default:
+            return std::make_unique<SgdOptimizer>();
+    }
+}
+
+void AdaGradOptimizer::reset(size_t numParameters) {
+    timeStep = 0;
+    squaredGradients.assign(numParameters, 0.0);
+}
+
+void AdaGradOptimizer::update(size_t index, double gradient, double learningRate, double &parameter) {
+    squaredGradients[index] += gradient * gradient;
+    parameter -= learningRate * gradient / (std::sqrt(squaredGradients[index]) + epsilon);
+}
+
+void AdamOptimizer::reset(size_t numParameters) {
+    timeStep = 0;
+    firstCorrection = 1.0;
+    secondCorrection = 1.0;
+    firstMoments.assign(numParameters, 0.0);
+    secondMoments.assign(numParameters, 0.0);
+}
+
+// Bias corrections depend only on the step count, so they are computed once per step
+void AdamOptimizer::step() {
+    Optimizer::step();
+    firstCorrection = 1.0 / (1.0 - std::pow(beta1, static_cast<double>(timeStep)));
+    secondCorrection = 1.0 / (1.0 - std::pow(beta2, static_cast<double>(timeStep)));
+}
+
+void AdamOptimizer::update(size_t index, double gradient, double learningRate, double &parameter) {
+    firstMoments[index] = beta1 * firstMoments[index] + (1.0 - beta1) * gradient;
+    secondMoments[index] = beta2 * secondMoments[index] + (1.0 - beta2) * gradient * gradient;
+
+    double firstCorrected = firstMoments[index] * firstCorrection;
+    double secondCorrected = secondMoments[index] * secondCorrection;
+    parameter -= learningRate * firstCorrected / (std::sqrt(secondCorrected) + epsilon);
+}
@@ -0,0 +1,87 @@
+#ifndef SENTIMENTANALYSIS_OPTIMIZER_H
+#define SENTIMENTANALYSIS_OPTIMIZER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+enum class OptimizerType {
+    Sgd,
+    AdaGrad,
+    Adam
+};
+
+// Per-parameter update rule shared by the trainers
+// Parameters are addressed by index, and state is kept per index, so a sparse trainer only pays for the
+// features present in a sample. Updates of distinct indices may run concurrently.
+class Optimizer {
+protected:
+    long long timeStep = 0;
+
+public:
+    virtual ~Optimizer() = default;
+
+    // Allocate zeroed state for numParameters parameters and restart the step count
+    virtual void reset(size_t numParameters) = 0;
+
+    // Start a new optimization step (one sample or one mini-batch)
+    virtual void step() { ++timeStep; }
+
+    // Apply the gradient of one parameter
+    virtual void update(size_t index, double gradient, double learningRate, double &parameter) = 0;
+
+    // Apply the gradients of count consecutive parameters starting at index
+    void updateRange(size_t index, size_t count, const double *gradient, double learningRate, double *parameters) {
+        for (size_t i = 0; i < count; ++i) {
+            update(index + i, gradient[i], learningRate, parameters[i]);
+        }
+    }
+
+    static std::unique_ptr<Optimizer> create(OptimizerType type);
+};
+
+// Plain gradient descent, no state
+class SgdOptimizer : public Optimizer {
+public:
+    void reset(size_t) override { timeStep = 0; }
+    void update(size_t, double gradient, double learningRate, double &parameter) override {
+        parameter -= learningRate * gradient;
+    }
+};
+
+// AdaGrad: each parameter's rate decays with its own accumulated squared gradient,
+// so rare features keep taking large steps while frequent ones settle
+class AdaGradOptimizer : public Optimizer {
+private:
+    std::vector<double> squaredGradients;
+    double epsilon;
+
+public:
+    explicit AdaGradOptimizer(double epsilon = 1e-8) : epsilon(epsilon) {}
+    void reset(size_t numParameters) override;
+    void update(size_t index, double gradient, double learningRate, double &parameter) override;
+};
+
+// Adam with lazy moments: the moment estimates of a parameter only decay when it receives a gradient,
+// so a step costs O(active parameters). Bias correction uses the global step count.
+class AdamOptimizer : public Optimizer {
+private:
+    std::vector<double> firstMoments;
+    std::vector<double> secondMoments;
+    double beta1;
+    double beta2;
+    double epsilon;
+    double firstCorrection = 1.0;  // 1 / (1 - beta1^t) for the current step
+    double secondCorrection = 1.0; // 1 / (1 - beta2^t) for the current step
+
+public:
+    explicit AdamOptimizer(double beta1 = 0.9, double beta2 = 0.999, double epsilon = 1e-8)
+            : beta1(beta1), beta2(beta2), epsilon(epsilon) {}
+    void reset(size_t numParameters) override;
+    void step() override;
+    void update(size_t index, double gradient, double learningRate, double &parameter) override;
+};
+
+
+#endif //SENTIMENTANALYSIS_OPTIMIZER_H
@@ -3,84 +3,353 @@
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include <chrono>
+#include <memory>
+#include <limits>
+#include <random>
 #include "TextPreprocessor.h"
 
+namespace {
+
+// Spread of the projected gradients over the active samples below which the shrunk problem counts as solved
+// It is absolute, like liblinear's eps for its dual solvers, while the stopping tolerance is a relative duality gap
+const double SHRINKING_TOLERANCE = 0.1;
+
+}
+
 // Constructor: Initializes the bias to 0.0
 SimpleSVM::SimpleSVM() : bias(0.0) {}
 
 // Predict the raw output (margin) before applying the decision rule
-// Returns the dot product of weights and features plus the bias
-double SimpleSVM::predictRaw(const std::vector<double>& features) {
-    return std::inner_product(features.begin(), features.end(), weights.begin(), 0.0) + bias;
+// Returns the dot product of weights and the sparse features plus the bias
+double SimpleSVM::predictRaw(const SparseView& features) const {
+    return weightScale * dot(features, weightValues()) + bias;
 }
 
 // Update the weights and bias based on the SVM hinge loss
-// Uses the margin to determine whether the current prediction is correct or not
-void SimpleSVM::updateWeights(const std::vector<double>& features, double label, double learningRate, double regularizationParam) {
-    double margin = label * predictRaw(features);
-
-    if (margin >= 1) {
-        // No error, just apply regularization
-        for (size_t i = 0; i < weights.size(); ++i) {
-            weights[i] -= learningRate * regularizationParam * weights[i];
-        }
-    } else {
-        // Prediction error, apply regularization and update rule
-        for (size_t i = 0; i < weights.size(); ++i) {
-            weights[i] += learningRate * (label * features[i] - regularizationParam * weights[i]);
-        }
+// Uses the precomputed margin to determine whether the current prediction is correct or not.
+// The regularization shrink of every weight is a single multiply of weightScale, and only the
+// sample's nonzero features are touched on a margin violation, so an update costs O(nnz)
+void SimpleSVM::updateWeights(const SparseView& features, double label, double margin, double learningRate, double regularizationParam) {
+    // Apply regularization to every weight
+    weightScale *= 1.0 - learningRate * regularizationParam;
+
+    if (margin < 1) {
+        // Prediction error, apply the update rule to the features present in the sample
+        axpy(learningRate * label / weightScale, features, weights);
         bias += learningRate * label;
     }
+
+    // Fold the scale back into the weights before it underflows
+    if (weightScale < 1e-9) {
+        foldWeightScale();
+    }
+}
+
+// Update the weights and bias through the optimizer
+// Only the sample's nonzero features and the bias are updated; their regularization gradient is added
+// here, so features absent from a sample are not decayed on that step
+void SimpleSVM::updateWeightsAdaptive(const SparseView& features, double label, double margin, double learningRate, double regularizationParam) {
+    double outputGradient = margin < 1 ? -label : 0.0; // Hinge loss subgradient
+    optimizer->step();
+    for (size_t k = 0; k < features.nnz; ++k) {
+        uint32_t feature = features.indices[k];
+        double featureGradient = outputGradient * features.values[k] + regularizationParam * weights[feature];
+        optimizer->update(feature, featureGradient, learningRate, weights[feature]);
+    }
+    if (margin < 1) {
+        optimizer->update(weights.size(), outputGradient, learningRate, bias);
+    }
+}
+
+// Multiply the pending scale factor into the stored weights
+void SimpleSVM::foldWeightScale() {
+    if (weightScale != 1.0) {
+        for (double& weight : weights) {
+            weight *= weightScale;
+        }
+        weightScale = 1.0;
+    }
+}
+
+// Run one Hogwild epoch: every thread takes a contiguous shard of the rows and applies sparse hinge-loss
+// steps to the shared weights without locks. Regularization decays only the features of each sample,
+// because a shared lazy scale factor would be written by every update and serialize the threads.
+// Bias steps are buffered per thread and published in batches (see AtomicBias).
+// Returns the total hinge loss of the epoch.
+double SimpleSVM::trainEpochHogwild(const CsrMatrix& dataset, ThreadPool& pool, AtomicWeights& sharedWeights, AtomicBias& sharedBias,
+                                    double learningRate, double regularizationParam) {
+    int numShards = pool.size();
+    std::vector<double> shardLoss(numShards, 0.0);
+    double decay = 1.0 - learningRate * regularizationParam;
+
+    pool.run(numShards, [&](int shard) {
+        size_t begin = dataset.numRows() * shard / numShards;
+        size_t end = dataset.numRows() * (shard + 1) / numShards;
+        double loss = 0.0;
+        double biasBase = sharedBias.load();
+        double biasStep = 0.0; // Not yet published to sharedBias
+
+        for (size_t i = begin; i < end; ++i) {
+            SparseView features = dataset.row(i);
+            int label = dataset.label(i) == 1 ? 1 : -1; // Convert label to +1 or -1
+
+            double margin = label * (sharedWeights.dot(features) + biasBase + biasStep);
+            loss += std::max(0.0, 1.0 - margin); // Hinge loss
+
+            if (margin < 1) {
+                sharedWeights.update(features, decay, learningRate * label);
+                biasStep += learningRate * label;
+            } else {
+                sharedWeights.update(features, decay, 0.0);
+            }
+            if ((i - begin + 1) % AtomicBias::PUBLISH_INTERVAL == 0) {
+                sharedBias.add(biasStep);
+                biasStep = 0.0;
+                biasBase = sharedBias.load();
+            }
+        }
+        sharedBias.add(biasStep);
+        shardLoss[shard] = loss;
+    });
+
+    return std::accumulate(shardLoss.begin(), shardLoss.end(), 0.0);
 }
 
 // Train the SVM model using the dataset and vocabulary
-// Adjusts the weights and bias over multiple epochs using the hinge loss function
-void SimpleSVM::train(Dataset& dataset, const std::unordered_map<std::string, int>& vocabulary, Dataset& devData, double learningRate, int epochs, double regularizationParam, bool verbose) {
+// Adjusts the weights and bias over multiple epochs using the hinge loss function.
+// With more than one thread the epochs run in Hogwild mode instead.
+void SimpleSVM::train(const CsrMatrix& dataset, const CsrMatrix& devData, double learningRate, int epochs, double regularizationParam, bool verbose) {
+    if (learningRate * regularizationParam >= 1.0) {
+        std::cerr << "learningRate * regularizationParam must be below 1, got " << learningRate * regularizationParam << std::endl;
+        return;
+    }
+
     // Resize weights to match the number of features (vocabulary size)
-    weights.resize(vocabulary.size(), 0.0);
+    mappedWeights.detach(weights);
+    weights.resize(dataset.numCols(), 0.0);
+
+    foldWeightScale();
+    if (optimizer) {
+        optimizer->reset(weights.size() + 1); // One slot per feature plus the bias
+    }
+    std::unique_ptr<ThreadPool> pool;
+    std::unique_ptr<AtomicWeights> sharedWeights;
+    AtomicBias sharedBias(bias);
+    if (numThreads > 1 && optimizer) {
+        std::cerr << "Adaptive optimizers train on a single thread; ignoring the thread count of " << numThreads << std::endl;
+    } else if (numThreads > 1) {
+        pool = std::make_unique<ThreadPool>(numThreads);
+        sharedWeights = std::make_unique<AtomicWeights>(weights);
+    }
+    double trainingSeconds = 0.0;
 
     for (int epoch = 0; epoch < epochs; ++epoch) {
         double totalLoss = 0.0;
+        auto start = std::chrono::steady_clock::now();
 
-        for (const auto& sample : dataset.getData()) {
-            auto tokens = sample.getTokens();
-            int label = sample.getLabel() == 1 ? 1 : -1; // Convert label to +1 or -1
-
-            // Create the feature vector for the current sample
-            auto featureVector = TextPreprocessor::createFeatureVector(tokens, vocabulary);
+        if (pool) {
+            totalLoss = trainEpochHogwild(dataset, *pool, *sharedWeights, sharedBias, learningRate, regularizationParam);
+        } else {
+            for (size_t i = 0; i < dataset.numRows(); ++i) {
+                SparseView features = dataset.row(i);
+                int label = dataset.label(i) == 1 ? 1 : -1; // Convert label to +1 or -1
 
-            // Update weights and bias based on the current sample
-            updateWeights(featureVector, label, learningRate, regularizationParam);
+                // Compute the margin once; it drives both the hinge loss and the update
+                double margin = label * predictRaw(features);
+                totalLoss += std::max(0.0, 1.0 - margin); // Hinge loss
 
-            // Calculate hinge loss for the current sample
-            double margin = label * predictRaw(featureVector);
-            totalLoss += std::max(0.0, 1.0 - margin); // Hinge loss
+                // Update weights and bias based on the current sample
+                if (optimizer) {
+                    updateWeightsAdaptive(features, label, margin, learningRate, regularizationParam);
+                } else {
+                    updateWeights(features, label, margin, learningRate, regularizationParam);
+                }
+            }
         }
+        trainingSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
         if (verbose) {
+            // Evaluate on a snapshot of the shared weights
+            if (sharedWeights) {
+                sharedWeights->copyTo(weights);
+                bias = sharedBias.load();
+            }
             std::cout << "Epoch " << epoch + 1 << ", Loss: " << totalLoss << std::endl;
-            double accuracy = evaluate(devData, vocabulary);
+            double accuracy = evaluate(devData);
             std::cout << "Validation Accuracy: " << accuracy << "%" << std::endl;
         }
     }
+
+    if (sharedWeights) {
+        sharedWeights->copyTo(weights);
+        bias = sharedBias.load();
+    }
+    foldWeightScale();
+
+    if (verbose && trainingSeconds > 0.0) {
+        int threadsUsed = pool ? numThreads : 1;
+        std::cout << "Throughput: " << dataset.numRows() * epochs / trainingSeconds << " samples/sec with "
+                  << threadsUsed << (threadsUsed > 1 ? " threads (Hogwild)" : " thread") << std::endl;
+    }
+}
+
+// Train with dual coordinate descent
+// Each step solves the dual problem exactly in one variable alpha_i and keeps w = sum(alpha_i * y_i * x_i)
+// up to date, so a pass costs O(total nnz) and needs no learning rate. The bias is an extra feature fixed
+// at 1 (and is regularized with the weights, as in liblinear). Samples whose alpha sits at a bound with a
+// gradient pointing outward are shrunk from the active set, and training stops once the duality gap
+// relative to the primal objective falls below the tolerance.
+void SimpleSVM::trainDual(const CsrMatrix& dataset, const CsrMatrix& devData, double regularizationParam, SvmLoss loss,
+                          int maxIterations, double tolerance, bool verbose) {
+    size_t numSamples = dataset.numRows();
+    if (numSamples == 0 || regularizationParam <= 0.0) {
+        std::cerr << "Dual coordinate descent needs training samples and a positive regularization parameter" << std::endl;
+        return;
+    }
+
+    double C = 1.0 / (regularizationParam * numSamples);
+    // Hinge loss boxes alpha in [0, C]; squared hinge leaves it unbounded and adds 1 / (2C) to the diagonal
+    double upperBound = loss == SvmLoss::Hinge ? C : std::numeric_limits<double>::infinity();
+    double diagonal = loss == SvmLoss::Hinge ? 0.0 : 1.0 / (2.0 * C);
+
+    mappedWeights.detach(weights);
+    weights.assign(dataset.numCols(), 0.0);
+    weightScale = 1.0;
+    bias = 0.0;
+
+    std::vector<double> alpha(numSamples, 0.0);
+    std::vector<double> diagonalQ(numSamples); // ||x_i||^2 + 1 for the bias feature, plus the loss diagonal
+    for (size_t i = 0; i < numSamples; ++i) {
+        SparseView features = dataset.row(i);
+        diagonalQ[i] = diagonal + 1.0;
+        for (size_t k = 0; k < features.nnz; ++k) {
+            diagonalQ[i] += features.values[k] * features.values[k];
+        }
+    }
+
+    std::vector<size_t> active(numSamples);
+    std::iota(active.begin(), active.end(), 0);
+    size_t activeSize = numSamples;
+    std::mt19937 gen(0);
+
+    // Projected gradient bounds of the previous pass, used by the shrinking test
+    double maxGradientOld = std::numeric_limits<double>::infinity();
+    double minGradientOld = -std::numeric_limits<double>::infinity();
+
+    for (int iteration = 0; iteration < maxIterations; ++iteration) {
+        double maxGradient = -std::numeric_limits<double>::infinity();
+        double minGradient = std::numeric_limits<double>::infinity();
+        std::shuffle(active.begin(), active.begin() + activeSize, gen);
+
+        for (size_t s = 0; s < activeSize; ++s) {
+            size_t i = active[s];
+            SparseView features = dataset.row(i);
+            int label = dataset.label(i) == 1 ? 1 : -1;
+
+            double gradient = label * predictRaw(features) - 1.0 + diagonal * alpha[i];
+            double projectedGradient = 0.0;
+            if (alpha[i] == 0.0) {
+                if (gradient > maxGradientOld) {
+                    // Stuck at the lower bound and likely to stay there: shrink
+                    std::swap(active[s], active[--activeSize]);
+                    --s;
+                    continue;
+                }
+                projectedGradient = std::min(gradient, 0.0);
+            } else if (alpha[i] == upperBound) {
+                if (gradient < minGradientOld) {
+                    std::swap(active[s], active[--activeSize]);
+                    --s;
+                    continue;
+                }
+                projectedGradient = std::max(gradient, 0.0);
+            } else {
+                projectedGradient = gradient;
+            }
+
+            maxGradient = std::max(maxGradient, projectedGradient);
+            minGradient = std::min(minGradient, projectedGradient);
+
+            if (std::fabs(projectedGradient) > 1e-12) {
+                double oldAlpha = alpha[i];
+                alpha[i] = std::min(std::max(alpha[i] - gradient / diagonalQ[i], 0.0), upperBound);
+                double delta = (alpha[i] - oldAlpha) * label;
+                axpy(delta, features, weights);
+                bias += delta;
+            }
+        }
+
+        // Duality gap over all samples: primal 0.5 ||w||^2 + C * sum(loss), dual sum(alpha) - 0.5 ||w||^2 - 0.5 * D * sum(alpha^2)
+        double normSquared = bias * bias;
+        for (double weight : weights) {
+            normSquared += weight * weight;
+        }
+        double lossSum = 0.0;
+        double alphaSum = 0.0;
+        double alphaSquaredSum = 0.0;
+        for (size_t i = 0; i < numSamples; ++i) {
+            int label = dataset.label(i) == 1 ? 1 : -1;
+            double slack = std::max(0.0, 1.0 - label * predictRaw(dataset.row(i)));
+            lossSum += loss == SvmLoss::Hinge ? slack : slack * slack;
+            alphaSum += alpha[i];
+            alphaSquaredSum += alpha[i] * alpha[i];
+        }
+        double primal = 0.5 * normSquared + C * lossSum;
+        double dual = alphaSum - 0.5 * normSquared - 0.5 * diagonal * alphaSquaredSum;
+        double gap = (primal - dual) / std::max(std::fabs(primal), 1e-12);
+
+        if (verbose) {
+            std::cout << "Iteration " << iteration + 1 << ", Primal: " << primal << ", Duality gap: " << gap
+                      << ", Active samples: " << activeSize << std::endl;
+        }
+        if (gap <= tolerance) {
+            break;
+        }
+
+        if (maxGradient - minGradient <= SHRINKING_TOLERANCE || activeSize == 0) {
+            // The shrunk problem has converged but the full one has not: restore all samples
+            activeSize = numSamples;
+            maxGradientOld = std::numeric_limits<double>::infinity();
+            minGradientOld = -std::numeric_limits<double>::infinity();
+            continue;
+        }
+        maxGradientOld = maxGradient > 0.0 ? maxGradient : std::numeric_limits<double>::infinity();
+        minGradientOld = minGradient < 0.0 ? minGradient : -std::numeric_limits<double>::infinity();
+    }
+
+    if (verbose) {
+        double accuracy = evaluate(devData);
+        std::cout << "Validation Accuracy: " << accuracy << "%" << std::endl;
+    }
+}
+
+// Set the number of training threads; 0 uses all hardware threads
+void SimpleSVM::setNumThreads(int threads) {
+    numThreads = threads > 0 ? threads : ThreadPool::defaultThreadCount();
+}
+
+// Set the optimizer used by train; pass nullptr to go back to plain SGD
+void SimpleSVM::setOptimizer(std::unique_ptr<Optimizer> newOptimizer) {
+    optimizer = std::move(newOptimizer);
 }
 
 // Predict the label (0 or 1) for a given sample based on the tokens
 // Converts the raw prediction (margin) to a binary class label
-int SimpleSVM::predict(const std::vector<std::string>& tokens, const std::unordered_map<std::string, int>& vocabulary) {
-    auto featureVector = TextPreprocessor::createFeatureVector(tokens, vocabulary);
+int SimpleSVM::predict(TokenView tokens, const Vocabulary& vocabulary) {
+    auto featureVector = TextPreprocessor::createSparseFeatureVector(tokens, vocabulary);
     return predictRaw(featureVector) >= 0.0 ? 1 : 0;
 }
 
 // Evaluate the accuracy of the SVM model on a validation dataset
 // Compares predicted labels with true labels to calculate the accuracy
-double SimpleSVM::evaluate(Dataset& dataset, const std::unordered_map<std::string, int>& vocabulary) {
+double SimpleSVM::evaluate(const CsrMatrix& dataset) {
     int correct_predictions = 0;
     int total_predictions = 0;
 
-    for (const auto& sample : dataset.getData()) {
-        int predicted_label = predict(sample.getTokens(), vocabulary);
-        if (predicted_label == sample.getLabel()) {
+    for (size_t i = 0; i < dataset.numRows(); ++i) {
+        int predicted_label = predictRaw(dataset.row(i)) >= 0.0 ? 1 : 0;
+        if (predicted_label == dataset.label(i)) {
             correct_predictions++;
         }
         total_predictions++;
@@ -92,42 +361,43 @@ double SimpleSVM::evaluate(Dataset& dataset, const std::unordered_map<std::strin
 // Save the current weights and bias to a binary file
 // Useful for saving the trained model to disk for later use
 void SimpleSVM::saveWeights(const std::string& filename) const {
-    std::ofstream outFile(filename, std::ios::out | std::ios::binary);
-
-    if (!outFile.is_open()) {
-        std::cerr << "Error opening file for saving weights: " << filename << std::endl;
-        return;
-    }
+    modelWriter().write(filename);
+}
 
-    // Save weights
-    for (double weight : weights) {
-        outFile.write(reinterpret_cast<const char*>(&weight), sizeof(weight));
-    }
+// Load the weights and bias from a binary file
+// The file is mapped and the weights are used in place. A model that already has weights must match the file;
+// an untrained one takes the number of weights from the file.
+bool SimpleSVM::loadWeights(const std::string& filename, bool verifyChecksums) {
+    ModelFile file;
+    int expectedFeatures = weightCount() > 0 ? static_cast<int>(weightCount()) : -1;
+    return file.open(filename, ModelType::SimpleSVM, verifyChecksums) && useModelFile(std::move(file), expectedFeatures);
+}
 
-    // Save bias
-    outFile.write(reinterpret_cast<const char*>(&bias), sizeof(bias));
+// Save the model together with its vocabulary, so it can be used without the training data
+void SimpleSVM::saveBundle(const std::string& filename, const Vocabulary& vocabulary, uint64_t stopwordsHash) const {
+    ModelBundle::save(filename, modelWriter(), vocabulary, stopwordsHash);
+}
 
-    outFile.close();
+// Load a bundle saved by saveBundle
+bool SimpleSVM::loadBundle(const std::string& filename, uint64_t stopwordsHash, Vocabulary& vocabulary, bool verifyChecksums) {
+    return ModelBundle::load(filename, ModelType::SimpleSVM, stopwordsHash, vocabulary, verifyChecksums,
+                             [this](ModelFile&& file, int expectedFeatures) { return useModelFile(std::move(file), expectedFeatures); });
 }
 
-// Load the weights and bias from a binary file
-// Allows the model to be restored from a previously saved state
-bool SimpleSVM::loadWeights(const std::string& filename) {
-    std::ifstream inFile(filename, std::ios::in | std::ios::binary);
+// Collect the sections of a saved model: the number of weights and the bias, then the weights
+ModelFileWriter SimpleSVM::modelWriter() const {
+    ModelFileWriter writer(ModelType::SimpleSVM);
+    MappedWeights::addSections(writer, weightValues(), weightCount(), bias);
+    return writer;
+}
 
-    if (!inFile.is_open()) {
-        std::cerr << "Error opening file for loading weights: " << filename << std::endl;
+// Point the model at the weights of a mapped model file
+// A non-negative expectedFeatures must match the number of weights in the file; the model is untouched on failure
+bool SimpleSVM::useModelFile(ModelFile&& file, int expectedFeatures) {
+    if (!mappedWeights.open(std::move(file), expectedFeatures, bias)) {
         return false;
     }
-
-    // Load weights
-    for (double& weight : weights) {
-        inFile.read(reinterpret_cast<char*>(&weight), sizeof(weight));
-    }
-
-    // Load bias
-    inFile.read(reinterpret_cast<char*>(&bias), sizeof(bias));
-
-    inFile.close();
+    weightScale = 1.0;
+    std::vector<double>().swap(weights);
     return true;
 }
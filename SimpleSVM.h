@@ -4,24 +4,59 @@
 #include <vector>
 #include <unordered_map>
 #include "Dataset.h"
+#include "Vocabulary.h"
+#include "AtomicWeights.h"
+#include "ThreadPool.h"
+#include "Optimizer.h"
+#include "ModelBundle.h"
+
+// Loss minimized by the dual coordinate descent solver
+enum class SvmLoss {
+    Hinge,        // max(0, 1 - y f(x))
+    SquaredHinge  // max(0, 1 - y f(x))^2
+};
 
 class SimpleSVM {
 private:
-    std::vector<double> weights;
+    std::vector<double> weights; // Effective weights are weightScale * weights
+    double weightScale = 1.0;
     double bias;
+    int numThreads = 1; // More than one thread trains with lock-free Hogwild SGD
+    std::unique_ptr<Optimizer> optimizer; // Per-feature update rule; null for the built-in SGD with lazy L2
+    MappedWeights mappedWeights;          // Loaded model file; while it is open the weights are read from it in place
 
-    double predictRaw(const std::vector<double>& features);
-    void updateWeights(const std::vector<double>& features, double label, double learningRate, double regularizationParam);
+    double predictRaw(const SparseView& features) const;
+    void updateWeights(const SparseView& features, double label, double margin, double learningRate, double regularizationParam);
+    void foldWeightScale();
+    void updateWeightsAdaptive(const SparseView& features, double label, double margin, double learningRate, double regularizationParam);
+    double trainEpochHogwild(const CsrMatrix& dataset, ThreadPool& pool, AtomicWeights& sharedWeights, AtomicBias& sharedBias,
+                             double learningRate, double regularizationParam);
+    const double* weightValues() const { return mappedWeights.isOpen() ? mappedWeights.data() : weights.data(); }
+    size_t weightCount() const { return mappedWeights.isOpen() ? mappedWeights.size() : weights.size(); }
+    ModelFileWriter modelWriter() const;
+    bool useModelFile(ModelFile&& file, int expectedFeatures);
 
 public:
     SimpleSVM();
-    void train(Dataset& dataset, const std::unordered_map<std::string, int>& vocabulary, Dataset& devData, double learningRate, int epochs, double regularizationParam, bool verbose=true);
-    int predict(const std::vector<std::string>& tokens, const std::unordered_map<std::string, int>& vocabulary);
-    double evaluate(Dataset& dataset, const std::unordered_map<std::string, int>& vocabulary);
+    void train(const CsrMatrix& dataset, const CsrMatrix& devData, double learningRate, int epochs, double regularizationParam, bool verbose=true);
+    // Dual coordinate descent solver (as in liblinear) for L2-regularized hinge or squared-hinge loss
+    // Uses the same objective as train with C = 1 / (regularizationParam * n) and stops on the relative duality gap
+    void trainDual(const CsrMatrix& dataset, const CsrMatrix& devData, double regularizationParam, SvmLoss loss = SvmLoss::Hinge,
+                   int maxIterations = 100, double tolerance = 0.01, bool verbose = true);
+    void setNumThreads(int threads);
+    // Train with an adaptive optimizer instead of plain SGD; such training runs on a single thread
+    void setOptimizer(std::unique_ptr<Optimizer> newOptimizer);
+    int predict(TokenView tokens, const Vocabulary& vocabulary);
+    double evaluate(const CsrMatrix& dataset);
 
     // Functions for saving and loading model weights
     void saveWeights(const std::string& filename) const;
-    bool loadWeights(const std::string& filename);
+    // Loading maps the file in place; verifyChecksums = false skips hashing the weights, so loading is O(1)
+    bool loadWeights(const std::string& filename, bool verifyChecksums = true);
+
+    // Save or load a self-contained bundle with the vocabulary the weights are indexed by
+    void saveBundle(const std::string& filename, const Vocabulary& vocabulary, uint64_t stopwordsHash) const;
+    bool loadBundle(const std::string& filename, uint64_t stopwordsHash, Vocabulary& vocabulary, bool verifyChecksums = true);
 };
 
 #endif // SimpleSVM_H
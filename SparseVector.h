@@ -0,0 +1,51 @@
+#ifndef SENTIMENTANALYSIS_SPARSEVECTOR_H
+#define SENTIMENTANALYSIS_SPARSEVECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Non-owning view of sorted (index, value) pairs, e.g. a SparseVector or one row of a CsrMatrix
+struct SparseView {
+    const uint32_t *indices = nullptr;
+    const double *values = nullptr;
+    size_t nnz = 0;
+};
+
+// Sparse feature vector stored as parallel arrays of sorted, unique indices and their values
+// A tweet has about ten nonzero features, so operations on it cost O(nnz) instead of O(vocabulary)
+struct SparseVector {
+    std::vector<uint32_t> indices;
+    std::vector<double> values;
+
+    size_t nnz() const { return indices.size(); }
+    SparseView view() const { return {indices.data(), values.data(), indices.size()}; }
+    operator SparseView() const { return view(); }
+};
+
+// Dot product of a sparse vector with dense weights
+inline double dot(const SparseView &x, const double *dense) {
+    double sum = 0.0;
+    for (size_t k = 0; k < x.nnz; ++k) {
+        sum += x.values[k] * dense[x.indices[k]];
+    }
+    return sum;
+}
+
+inline double dot(const SparseView &x, const std::vector<double> &dense) {
+    return dot(x, dense.data());
+}
+
+// dense += alpha * x, touching only the nonzero entries of x
+inline void axpy(double alpha, const SparseView &x, double *dense) {
+    for (size_t k = 0; k < x.nnz; ++k) {
+        dense[x.indices[k]] += alpha * x.values[k];
+    }
+}
+
+inline void axpy(double alpha, const SparseView &x, std::vector<double> &dense) {
+    axpy(alpha, x, dense.data());
+}
+
+
+#endif //SENTIMENTANALYSIS_SPARSEVECTOR_H
@@ -0,0 +1,60 @@
+#include "StringInterner.h"
+
+#include <mutex>
+
+StringInterner &StringInterner::global() {
+    static StringInterner interner;
+    return interner;
+}
+
+// Function to get the id of a token, assigning a new one if the token is unseen
+// Most tokens are repeats, so the common path only takes a shared lock
+uint32_t StringInterner::intern(std::string_view token) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(token);
+        if (it != ids.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(token);
+    if (it != ids.end()) {
+        return it->second; // Another thread interned it in the meantime
+    }
+    auto id = static_cast<uint32_t>(strings.size());
+    strings.emplace_back(token);
+    ids.emplace(strings.back(), id);
+    return id;
+}
+
+// Function to intern a whole token list, preserving order
+std::vector<uint32_t> StringInterner::intern(const std::vector<std::string> &tokens) {
+    std::vector<uint32_t> result;
+    result.reserve(tokens.size());
+    for (const auto &token : tokens) {
+        result.push_back(intern(token));
+    }
+    return result;
+}
+
+bool StringInterner::find(std::string_view token, uint32_t &id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(token);
+    if (it == ids.end()) {
+        return false;
+    }
+    id = it->second;
+    return true;
+}
+
+const std::string &StringInterner::str(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return strings.at(id);
+}
+
+size_t StringInterner::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return strings.size();
+}
@@ -0,0 +1,37 @@
+#ifndef SENTIMENTANALYSIS_STRINGINTERNER_H
+#define SENTIMENTANALYSIS_STRINGINTERNER_H
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Thread-safe table that maps each distinct token string to a compact uint32 id
+// Ids are assigned in first-seen order and stay valid for the lifetime of the interner
+class StringInterner {
+private:
+    mutable std::shared_mutex mutex;
+    std::deque<std::string> strings; // deque keeps element addresses stable, so the map can key on views
+    std::unordered_map<std::string_view, uint32_t> ids;
+
+public:
+    // Process-wide interner shared by every Dataset and model
+    static StringInterner &global();
+
+    uint32_t intern(std::string_view token);
+    std::vector<uint32_t> intern(const std::vector<std::string> &tokens);
+
+    // Looks up a token without inserting it; returns false if it has never been interned
+    bool find(std::string_view token, uint32_t &id) const;
+
+    // String for an id, intended for debugging, display and serialization
+    const std::string &str(uint32_t id) const;
+
+    size_t size() const;
+};
+
+
+#endif //SENTIMENTANALYSIS_STRINGINTERNER_H
@@ -1,13 +1,16 @@
 #include "TextPreprocessor.h"
+#include "Vocabulary.h"
 #include <math.h>
 
 // Function to remove punctuation and digits in a given string and convert to lowercase
 // This function cleans the text by removing unwanted characters and standardizing the case
-std::string TextPreprocessor::removePunctuationAndDigits(const std::string &text) {
+std::string TextPreprocessor::removePunctuationAndDigits(std::string_view text) {
     std::string result;
+    result.reserve(text.size());
     for (char c : text) {
-        if (!std::ispunct(c) && !std::isdigit(c)) {
-            result += std::tolower(c);
+        unsigned char uc = static_cast<unsigned char>(c);
+        if (!std::ispunct(uc) && !std::isdigit(uc)) {
+            result += static_cast<char>(std::tolower(uc));
         }
     }
     return result;
@@ -15,13 +18,21 @@ std::string TextPreprocessor::removePunctuationAndDigits(const std::string &text
 
 // Function to tokenize a string into a vector of words (tokens)
 // Splits the input string into individual words based on whitespace
-std::vector<std::string> TextPreprocessor::tokenizeWords(const std::string &text) {
+std::vector<std::string> TextPreprocessor::tokenizeWords(std::string_view text) {
     std::vector<std::string> tokens;
-    std::stringstream ss(text);
-    std::string token;
+    size_t i = 0;
 
-    while (ss >> token) {
-        tokens.push_back(token);
+    while (i < text.size()) {
+        while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i]))) {
+            i++;
+        }
+        size_t start = i;
+        while (i < text.size() && !std::isspace(static_cast<unsigned char>(text[i]))) {
+            i++;
+        }
+        if (i > start) {
+            tokens.emplace_back(text.substr(start, i - start));
+        }
     }
 
     return tokens;
@@ -116,11 +127,11 @@ std::vector<std::string> TextPreprocessor::provideStemming(const std::vector<std
 
 // Preprocessing function that applies all preprocessing steps to a given text
 // Combines all preprocessing steps: removing punctuation, tokenizing, removing stopwords, and stemming
-std::vector<std::string> TextPreprocessor::preprocess(const std::string &text, const std::unordered_set<std::string> &stopwords) {
-    std::string preprocessed_text = text;
+// Accepts a view so callers can pass text straight out of a mapped file without copying it first
+std::vector<std::string> TextPreprocessor::preprocess(std::string_view text, const std::unordered_set<std::string> &stopwords) {
     std::vector<std::string> tokens;
 
-    preprocessed_text = removePunctuationAndDigits(preprocessed_text);
+    std::string preprocessed_text = removePunctuationAndDigits(text);
     tokens = tokenizeWords(preprocessed_text);
     tokens = removeStopwords(tokens, stopwords);
     tokens = provideStemming(tokens);
@@ -128,15 +139,30 @@ std::vector<std::string> TextPreprocessor::preprocess(const std::string &text, c
     return tokens;
 }
 
-// Function to create a feature vector from tokens based on a given vocabulary
-// Converts a list of tokens into a numerical vector where each position corresponds to a word in the vocabulary
-std::vector<double> TextPreprocessor::createFeatureVector(const std::vector<std::string>& tokens, const std::unordered_map<std::string, int>& vocabulary) {
-    std::vector<double> featureVector(vocabulary.size(), 0.0);
-
-    for (const auto& token : tokens) {
-        auto it = vocabulary.find(token);
-        if (it != vocabulary.end()) {
-            featureVector[it->second] += 1.0;
+// Function to create a sparse bag-of-words feature vector from tokens based on a given vocabulary
+// Returns the sorted feature ids present in the tokens with their counts; tokens outside the vocabulary are dropped
+SparseVector TextPreprocessor::createSparseFeatureVector(TokenView tokens, const Vocabulary& vocabulary) {
+    SparseVector featureVector;
+
+    std::vector<uint32_t> features;
+    features.reserve(tokens.size());
+    for (uint32_t token : tokens) {
+        int feature = vocabulary.featureId(token);
+        if (feature >= 0) {
+            features.push_back(static_cast<uint32_t>(feature));
+        }
+    }
+    std::sort(features.begin(), features.end());
+
+    // Collapse repeated features into counts
+    featureVector.indices.reserve(features.size());
+    featureVector.values.reserve(features.size());
+    for (uint32_t feature : features) {
+        if (!featureVector.indices.empty() && featureVector.indices.back() == feature) {
+            featureVector.values.back() += 1.0;
+        } else {
+            featureVector.indices.push_back(feature);
+            featureVector.values.push_back(1.0);
         }
     }
 
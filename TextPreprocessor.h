@@ -2,6 +2,7 @@
 #define SENTIMENTANALYSIS_TEXTPREPROCESSOR_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
@@ -13,12 +14,15 @@
 #include <sstream>
 
 #include "Dataset.h"
+#include "SparseVector.h"
+
+class Vocabulary;
 
 class TextPreprocessor {
 private:
-    static std::string removePunctuationAndDigits(const std::string &text);
+    static std::string removePunctuationAndDigits(std::string_view text);
 
-    static std::vector<std::string> tokenizeWords(const std::string &text);
+    static std::vector<std::string> tokenizeWords(std::string_view text);
 
     static std::vector<std::string> removeStopwords(const std::vector<std::string> &tokens, const std::unordered_set<std::string> &stopwords);
 
@@ -26,9 +30,12 @@ private:
     static std::vector<std::string> provideStemming(const std::vector<std::string> &tokens);
 
 public:
+    // Bump whenever the preprocessing pipeline changes, so cached datasets are rebuilt
+    static constexpr int VERSION = 1;
+
     static std::unordered_set<std::string> readStopwords(const std::string &filename);
-    static std::vector<std::string> preprocess(const std::string &text, const std::unordered_set<std::string> &);
-    static std::vector<double> createFeatureVector(const std::vector<std::string>& tokens, const std::unordered_map<std::string, int>& vocabulary);
+    static std::vector<std::string> preprocess(std::string_view text, const std::unordered_set<std::string> &);
+    static SparseVector createSparseFeatureVector(TokenView tokens, const Vocabulary& vocabulary);
 
     };
 
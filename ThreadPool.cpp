@@ -0,0 +1,90 @@
+#include "ThreadPool.h"
+
+// Constructor starts numThreads - 1 workers (the caller is the remaining thread)
+// A non-positive numThreads uses one thread per hardware core
+ThreadPool::ThreadPool(int numThreads) {
+    if (numThreads <= 0) {
+        numThreads = defaultThreadCount();
+    }
+    for (int i = 1; i < numThreads; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+int ThreadPool::defaultThreadCount() {
+    unsigned int count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : static_cast<int>(count);
+}
+
+// Claims task indices from the shared counter until the batch is exhausted
+void ThreadPool::runTasks() {
+    int index;
+    while ((index = nextTask.fetch_add(1)) < numTasks) {
+        (*task)(index);
+    }
+}
+
+// Worker threads sleep until a new batch is published, help run it, then report back
+void ThreadPool::workerLoop() {
+    unsigned long seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeWorkers.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        runTasks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--activeWorkers == 0) {
+                batchDone.notify_one();
+            }
+        }
+    }
+}
+
+// Function to run a batch of tasks on the pool
+// Tasks must not call run() on the same pool
+void ThreadPool::run(int count, const std::function<void(int)> &fn) {
+    if (count <= 0) {
+        return;
+    }
+    if (workers.empty() || count == 1) {
+        for (int i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &fn;
+        numTasks = count;
+        nextTask = 0;
+        activeWorkers = static_cast<int>(workers.size());
+        generation++;
+    }
+    wakeWorkers.notify_all();
+
+    runTasks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    batchDone.wait(lock, [&] { return activeWorkers == 0; });
+    task = nullptr;
+}
@@ -0,0 +1,47 @@
+#ifndef SENTIMENTANALYSIS_THREADPOOL_H
+#define SENTIMENTANALYSIS_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads that runs batches of indexed tasks
+// The calling thread takes part in every batch, so a pool of size 1 runs everything inline
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable batchDone;
+
+    const std::function<void(int)> *task = nullptr;
+    int numTasks = 0;
+    std::atomic<int> nextTask{0};
+    int activeWorkers = 0;
+    unsigned long generation = 0;
+    bool stopping = false;
+
+    void workerLoop();
+    void runTasks();
+
+public:
+    explicit ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Runs task(i) for every i in [0, numTasks) and returns once all of them have finished
+    void run(int numTasks, const std::function<void(int)> &task);
+
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // Number of hardware threads, or 1 if it cannot be determined
+    static int defaultThreadCount();
+};
+
+
+#endif //SENTIMENTANALYSIS_THREADPOOL_H
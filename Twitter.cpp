@@ -1,24 +1,31 @@
 #include "Twitter.h"
+#include "CsvReader.h"
+#include "DatasetCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
 #include <filesystem>
 
-// Function to load data from a file into a Dataset object
-// Optionally limits the number of sentences loaded (useful for testing or smaller datasets)
-void Twitter::loadData(const std::string &filename, Dataset &dataset, int n_sentences) {
-    std::ifstream file;
-    file.open(filename);
-    std::string line;
-    int sentence_count = 0;
-
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string tweetID, entity, sentiment, text;
-        int label;
+// Function to parse and preprocess one record-aligned range of a CSV buffer
+// Returns the labeled samples in file order, stopping early once n_sentences samples are collected
+std::vector<DSText> Twitter::loadRange(std::string_view range, int n_sentences) const {
+    std::vector<DSText> samples;
+    CsvReader reader(range);
+    std::vector<std::string_view> fields;
 
-        // Extract fields from the CSV line
-        std::getline(iss, tweetID, ',');
-        std::getline(iss, entity, ',');
-        std::getline(iss, sentiment, ',');
-        std::getline(iss, text);
+    while (reader.next(fields)) {
+        if (fields.size() < 4) {
+            continue; // Skip malformed or empty lines
+        }
+
+        // Extract fields from the CSV record (tweetID, entity, sentiment, text)
+        std::string_view sentiment = fields[2];
+        std::string_view text = fields[3];
+        if (fields.size() > 4) {
+            // Unquoted text containing commas: keep everything up to the end of the record
+            text = std::string_view(text.data(), fields.back().data() + fields.back().size() - text.data());
+        }
+        int label;
 
         // Convert sentiment string to a label (1 for Positive, 0 for Negative)
         if (sentiment == "Positive") {
@@ -29,41 +36,108 @@ void Twitter::loadData(const std::string &filename, Dataset &dataset, int n_sent
             continue; // Skip sentences that are not labeled as Positive or Negative
         }
 
-        // Preprocess the text and add it to the dataset
-        std::vector<std::string> tokens = TextPreprocessor::preprocess(text, stopwords);
-        dataset.addTokens(tokens, label);
-
-        sentence_count++;
+        // Preprocess the text and keep it for the dataset
+        samples.emplace_back(TextPreprocessor::preprocess(text, stopwords), label);
 
         // Stop loading if the specified number of sentences is reached
-        if (n_sentences > 0 && sentence_count >= n_sentences) {
+        if (n_sentences > 0 && static_cast<int>(samples.size()) >= n_sentences) {
             break;
         }
     }
-    file.close();
+
+    return samples;
+}
+
+// Function to load data from a file into a Dataset object
+// Optionally limits the number of sentences loaded (useful for testing or smaller datasets)
+// The file is memory-mapped; a full load is split into record-aligned ranges and preprocessed on all cores,
+// and the per-range results are appended in file order, so the dataset matches a sequential load
+void Twitter::loadData(const std::string &filename, Dataset &dataset, int n_sentences) {
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        return;
+    }
+
+    // A limited load usually wants a small prefix of the file, so it preprocesses only that prefix, in order
+    if (n_sentences > 0) {
+        for (auto &sample : loadRange(file.view(), n_sentences)) {
+            dataset.addSample(std::move(sample));
+        }
+        return;
+    }
+
+    ThreadPool pool;
+    // Several ranges per thread keep the cores busy when labels are unevenly spread over the file
+    std::vector<size_t> boundaries = CsvReader::splitRecords(file.view(), pool.size() * 4);
+    std::vector<std::vector<DSText>> ranges(boundaries.size() - 1);
+
+    pool.run(static_cast<int>(ranges.size()), [&](int i) {
+        std::string_view range = file.view().substr(boundaries[i], boundaries[i + 1] - boundaries[i]);
+        ranges[i] = loadRange(range, 0);
+    });
+
+    for (auto &samples : ranges) {
+        for (auto &sample : samples) {
+            dataset.addSample(std::move(sample));
+        }
+    }
+}
+
+// Function to compute the cache key for a dataset file
+// Covers the file contents, the stopword list, the preprocessing pipeline version and the sentence limit
+uint64_t Twitter::cacheKey(const std::string &filename, int n_sentences) const {
+    MappedFile file(filename);
+    uint64_t key = hashBytes(file.data(), file.size());
+    key = hashCombine(key, stopwordsHash);
+    key = hashCombine(key, TextPreprocessor::VERSION);
+    key = hashCombine(key, static_cast<uint64_t>(std::max(n_sentences, 0)));
+    return key;
+}
+
+// Function to load a dataset, preferring a valid binary cache next to the source file
+// Rebuilds the cache from the CSV whenever it is missing or stale
+void Twitter::loadCachedData(const std::string &filename, Dataset &dataset, int n_sentences) {
+    if (!std::filesystem::exists(filename)) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return;
+    }
+
+    std::string cacheFile = filename + ".cache";
+    uint64_t key = cacheKey(filename, n_sentences);
+
+    if (DatasetCache::load(cacheFile, key, dataset)) {
+        std::cout << "Loaded preprocessed dataset from " << cacheFile << std::endl;
+        return;
+    }
+
+    loadData(filename, dataset, n_sentences);
+    DatasetCache::save(cacheFile, key, dataset);
 }
 
 // Function to load training data from a file
-// Calls loadData with the training dataset and optional sentence limit
+// Calls loadCachedData with the training dataset and optional sentence limit
 void Twitter::loadTrainData(std::string filename, int n_sentences) {
     std::cout << "Loading train dataset..." << std::endl;
-    loadData(filename, train, n_sentences);
+    loadCachedData(filename, train, n_sentences);
     std::cout << "Loading train dataset complete" << std::endl;
 }
 
 // Function to load validation data from a file
-// Calls loadData with the validation dataset and optional sentence limit
+// Calls loadCachedData with the validation dataset and optional sentence limit
 void Twitter::loadDevData(std::string filename, int n_sentences) {
     std::cout << "Loading validation dataset..." << std::endl;
-    loadData(filename, dev, n_sentences);
+    loadCachedData(filename, dev, n_sentences);
     std::cout << "Loading validation dataset complete" << std::endl;
 }
 
 // Function to load stopwords from a file
 // Uses the TextPreprocessor to read stopwords and stores them in an unordered_set
+// The file contents are also fingerprinted so cached datasets are invalidated when the list changes
 void Twitter::loadStopwords(std::string filename) {
     std::cout << "Loading stopwords..." << std::endl;
     stopwords = TextPreprocessor::readStopwords(filename);
+    MappedFile file(filename);
+    stopwordsHash = hashBytes(file.data(), file.size());
     std::cout << "Loading stopwords complete" << std::endl;
 }
 
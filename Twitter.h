@@ -4,11 +4,13 @@
 #include "Dataset.h"
 #include "TextPreprocessor.h"
 
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <string_view>
 
 
 class Twitter {
@@ -16,7 +18,11 @@ private:
     Dataset train;
     Dataset dev;
     unordered_set<string> stopwords;
+    uint64_t stopwordsHash = 0;
+    vector<DSText> loadRange(string_view range, int n_sentences) const;
     void loadData(const string &filename, Dataset &dataset, int n_sentences=-1);
+    uint64_t cacheKey(const string &filename, int n_sentences) const;
+    void loadCachedData(const string &filename, Dataset &dataset, int n_sentences=-1);
 
 public:
     void loadStopwords(string filename);
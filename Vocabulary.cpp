@@ -0,0 +1,101 @@
+#include "Vocabulary.h"
+#include "StringInterner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Constructor that builds the vocabulary from every token in the dataset
+// Collects counts and document frequencies in one pass, then applies the pruning limits
+Vocabulary::Vocabulary(Dataset &dataset, int minCount, int maxSize) {
+    const StringInterner &interner = StringInterner::global();
+    size_t numTokens = interner.size();
+
+    // Statistics per interned token, plus the order in which tokens first appear
+    std::vector<uint64_t> tokenCounts(numTokens, 0);
+    std::vector<uint32_t> tokenDocuments(numTokens, 0);
+    std::vector<size_t> lastDocument(numTokens, SIZE_MAX);
+    std::vector<uint32_t> firstSeen;
+
+    for (const auto &sample : dataset.getData()) {
+        for (uint32_t token : sample.getTokens()) {
+            if (tokenCounts[token]++ == 0) {
+                firstSeen.push_back(token);
+            }
+            // Count each token at most once per sample for the document frequency
+            if (lastDocument[token] != numDocuments) {
+                lastDocument[token] = numDocuments;
+                tokenDocuments[token]++;
+            }
+        }
+        numDocuments++;
+    }
+
+    std::vector<uint32_t> kept;
+    for (uint32_t token : firstSeen) {
+        if (tokenCounts[token] >= static_cast<uint64_t>(std::max(minCount, 1))) {
+            kept.push_back(token);
+        }
+    }
+
+    if (maxSize > 0 && kept.size() > static_cast<size_t>(maxSize)) {
+        // Keep the most frequent tokens (ties go to the earlier token), then restore first-seen order
+        std::vector<size_t> order(kept.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return tokenCounts[kept[a]] > tokenCounts[kept[b]];
+        });
+        order.resize(maxSize);
+        std::sort(order.begin(), order.end());
+
+        std::vector<uint32_t> pruned;
+        pruned.reserve(order.size());
+        for (size_t i : order) {
+            pruned.push_back(kept[i]);
+        }
+        kept.swap(pruned);
+    }
+
+    featureByToken.assign(numTokens, -1);
+    tokenByFeature = kept;
+    counts.reserve(kept.size());
+    documentFrequency.reserve(kept.size());
+    for (size_t feature = 0; feature < kept.size(); ++feature) {
+        featureByToken[kept[feature]] = static_cast<int32_t>(feature);
+        counts.push_back(tokenCounts[kept[feature]]);
+        documentFrequency.push_back(tokenDocuments[kept[feature]]);
+    }
+}
+
+// Constructor that interns saved tokens and assigns them feature ids in order
+Vocabulary::Vocabulary(const std::vector<std::string_view> &tokens) {
+    StringInterner &interner = StringInterner::global();
+    tokenByFeature.reserve(tokens.size());
+    for (std::string_view token : tokens) {
+        tokenByFeature.push_back(interner.intern(token));
+    }
+
+    featureByToken.assign(interner.size(), -1);
+    for (size_t feature = 0; feature < tokenByFeature.size(); ++feature) {
+        featureByToken[tokenByFeature[feature]] = static_cast<int32_t>(feature);
+    }
+    counts.assign(tokens.size(), 0);
+    documentFrequency.assign(tokens.size(), 0);
+}
+
+// Feature id of a token string; tokens that were never interned are not in the vocabulary
+int Vocabulary::featureId(std::string_view token) const {
+    uint32_t id;
+    if (!StringInterner::global().find(token, id)) {
+        return -1;
+    }
+    return featureId(id);
+}
+
+const std::string &Vocabulary::token(int feature) const {
+    return StringInterner::global().str(tokenByFeature[feature]);
+}
+
+double Vocabulary::idf(int feature) const {
+    return std::log((1.0 + numDocuments) / (1.0 + documentFrequency[feature])) + 1.0;
+}
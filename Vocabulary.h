@@ -0,0 +1,47 @@
+#ifndef SENTIMENTANALYSIS_VOCABULARY_H
+#define SENTIMENTANALYSIS_VOCABULARY_H
+
+#include "Dataset.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Frozen mapping from interned tokens to dense feature ids, built once from a training Dataset
+// Feature ids follow first-seen order in the dataset. Tokens can be pruned by minimum count and
+// the vocabulary capped to the most frequent tokens, which bounds the feature space and model size.
+class Vocabulary {
+private:
+    std::vector<int32_t> featureByToken;     // Interned token id to feature id, -1 if not in the vocabulary
+    std::vector<uint32_t> tokenByFeature;    // Feature id to interned token id
+    std::vector<uint64_t> counts;            // Feature id to total occurrences in the dataset
+    std::vector<uint32_t> documentFrequency; // Feature id to number of samples containing the token
+    size_t numDocuments = 0;
+
+public:
+    Vocabulary() = default;
+    // minCount drops tokens seen fewer times; a positive maxSize keeps only the most frequent tokens
+    explicit Vocabulary(Dataset &dataset, int minCount = 1, int maxSize = -1);
+    // Restore a saved vocabulary from its tokens in feature id order; counts and document frequencies are not kept
+    explicit Vocabulary(const std::vector<std::string_view> &tokens);
+
+    int size() const { return static_cast<int>(tokenByFeature.size()); }
+
+    // Feature id of a token, or -1 if it is not in the vocabulary
+    int featureId(uint32_t token) const {
+        return token < featureByToken.size() ? featureByToken[token] : -1;
+    }
+    int featureId(std::string_view token) const;
+
+    const std::string &token(int feature) const;
+    uint64_t count(int feature) const { return counts[feature]; }
+    uint32_t getDocumentFrequency(int feature) const { return documentFrequency[feature]; }
+    size_t getNumDocuments() const { return numDocuments; }
+
+    // Smoothed inverse document frequency: log((1 + N) / (1 + df)) + 1
+    double idf(int feature) const;
+};
+
+
+#endif //SENTIMENTANALYSIS_VOCABULARY_H
@@ -1,10 +1,14 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <algorithm>
 #include "LogisticRegression.h"
 #include "SimpleSVM.h"
 #include "NaiveBayes.h"
 #include "NeuralNetwork.h"
+#include "FTRLProximal.h"
+#include "ModelBundle.h"
+#include "StringInterner.h"
 #include "Twitter.h"
 
 
@@ -15,6 +19,7 @@ void displayMenu() {
     std::cout << "2. Logistic Regression" << std::endl;
     std::cout << "3. Support Vector Machine (SVM)" << std::endl;
     std::cout << "4. Neural Network" << std::endl;
+    std::cout << "5. Sparse Logistic Regression (FTRL-Proximal)" << std::endl;
     std::cout << "0. Exit" << std::endl;
 }
 
@@ -42,6 +47,28 @@ std::string promptFilename(const std::string& action) {
     return filename;
 }
 
+// Returns the chosen adaptive optimizer, or nullptr for plain SGD
+std::unique_ptr<Optimizer> promptOptimizer() {
+    std::cout << "Choose optimizer (1 - SGD, 2 - AdaGrad, 3 - Adam): ";
+    std::string choice;
+    std::cin >> choice;
+    if (choice == "2") {
+        return Optimizer::create(OptimizerType::AdaGrad);
+    } else if (choice == "3") {
+        return Optimizer::create(OptimizerType::Adam);
+    }
+    return nullptr;
+}
+
+std::pair<int, int> promptVocabularyLimits() {
+    std::pair<int, int> limits;
+    std::cout << "Enter the minimum number of occurrences for a vocabulary token (1 to keep all tokens): ";
+    std::cin >> limits.first;
+    std::cout << "Enter the maximum vocabulary size (-1 for no limit): ";
+    std::cin >> limits.second;
+    return limits;
+}
+
 std::pair<int, int> promptDatasetSize() {
     std::pair<int, int> n_sentences;
     std::cout << "Enter the number of sentences to load from train dataset (-1 for all sentences): ";
@@ -51,6 +78,19 @@ std::pair<int, int> promptDatasetSize() {
     return n_sentences;
 }
 
+// Preprocess a line typed by the user into the ids of its tokens that are already interned
+// A token the interner has never seen is in no vocabulary, so it is dropped instead of growing the interner
+std::vector<uint32_t> knownTokens(const std::string& text) {
+    std::vector<uint32_t> ids;
+    uint32_t id;
+    for (const std::string& token : TextPreprocessor::preprocess(text, TextPreprocessor::readStopwords("../data/stopwords.txt"))) {
+        if (StringInterner::global().find(token, id)) {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
 void predictTextSentiment(NaiveBayes& model) {
     std::string text;
     std::cout << "Enter a text to analyze sentiment (type 'exit' to return to the main menu): ";
@@ -69,7 +109,7 @@ void predictTextSentiment(NaiveBayes& model) {
 }
 
 
-void predictTextSentiment(LogisticRegression& model, const std::unordered_map<std::string, int>& vocabulary) {
+void predictTextSentiment(LogisticRegression& model, const Vocabulary& vocabulary) {
     std::string text;
     std::cout << "Enter a text to analyze sentiment (type 'exit' to return to the main menu): ";
     std::cin.ignore();  // to ignore any leftover newline character
@@ -78,7 +118,7 @@ void predictTextSentiment(LogisticRegression& model, const std::unordered_map<st
         if (text == "exit") {
             break;
         }
-        auto tokens = TextPreprocessor::preprocess(text, TextPreprocessor::readStopwords("../data/stopwords.txt"));
+        auto tokens = knownTokens(text);
         int prediction = model.predict(tokens, vocabulary);
         std::string sentiment = prediction == 1 ? "Positive" : "Negative";
         std::cout << "Predicted sentiment: " << sentiment << std::endl;
@@ -86,7 +126,7 @@ void predictTextSentiment(LogisticRegression& model, const std::unordered_map<st
     }
 }
 
-void predictTextSentiment(SimpleSVM& model, const std::unordered_map<std::string, int>& vocabulary) {
+void predictTextSentiment(SimpleSVM& model, const Vocabulary& vocabulary) {
     std::string text;
     std::cout << "Enter a text to analyze sentiment (type 'exit' to return to the main menu): ";
     std::cin.ignore();
@@ -95,7 +135,7 @@ void predictTextSentiment(SimpleSVM& model, const std::unordered_map<std::string
         if (text == "exit") {
             break;
         }
-        auto tokens = TextPreprocessor::preprocess(text, TextPreprocessor::readStopwords("../data/stopwords.txt"));
+        auto tokens = knownTokens(text);
         int prediction = model.predict(tokens, vocabulary);
         std::string sentiment = prediction == 1 ? "Positive" : "Negative";
         std::cout << "Predicted sentiment: " << sentiment << std::endl;
@@ -103,7 +143,7 @@ void predictTextSentiment(SimpleSVM& model, const std::unordered_map<std::string
     }
 }
 
-void predictTextSentiment(NeuralNetwork& model, const std::unordered_map<std::string, int>& vocabulary) {
+void predictTextSentiment(FTRLProximal& model, const Vocabulary& vocabulary) {
     std::string text;
     std::cout << "Enter a text to analyze sentiment (type 'exit' to return to the main menu): ";
     std::cin.ignore();
@@ -112,8 +152,25 @@ void predictTextSentiment(NeuralNetwork& model, const std::unordered_map<std::st
         if (text == "exit") {
             break;
         }
-        auto tokens = TextPreprocessor::preprocess(text, TextPreprocessor::readStopwords("../data/stopwords.txt"));
-        auto featureVector = TextPreprocessor::createFeatureVector(tokens, vocabulary);
+        auto tokens = knownTokens(text);
+        int prediction = model.predict(tokens, vocabulary);
+        std::string sentiment = prediction == 1 ? "Positive" : "Negative";
+        std::cout << "Predicted sentiment: " << sentiment << std::endl;
+        std::cout << "Enter another text to analyze sentiment (type 'exit' to return to the main menu): ";
+    }
+}
+
+void predictTextSentiment(NeuralNetwork& model, const Vocabulary& vocabulary) {
+    std::string text;
+    std::cout << "Enter a text to analyze sentiment (type 'exit' to return to the main menu): ";
+    std::cin.ignore();
+    while (true) {
+        std::getline(std::cin, text);
+        if (text == "exit") {
+            break;
+        }
+        auto tokens = knownTokens(text);
+        auto featureVector = TextPreprocessor::createSparseFeatureVector(tokens, vocabulary);
         int prediction = model.predict(featureVector);
         std::string sentiment = prediction == 1 ? "Positive" : "Negative";
         std::cout << "Predicted sentiment: " << sentiment << std::endl;
@@ -121,29 +178,111 @@ void predictTextSentiment(NeuralNetwork& model, const std::unordered_map<std::st
     }
 }
 
-void trainNaiveBayes(Twitter& twitter, Dataset& trainData, Dataset& devData) {
+// Vocabulary and matrices shared by every model trained in this session
+struct TrainingData {
+    Vocabulary vocabulary;
+    CsrMatrix trainMatrix;
+    CsrMatrix devMatrix;
+    uint64_t stopwordsHash = 0;
+};
+
+// Load the datasets and build the vocabulary and matrices the first time a model is trained
+// Loading a saved model does not need them, so an inference session never reads the training data
+const TrainingData& requireTrainingData(std::unique_ptr<TrainingData>& data) {
+    if (data) {
+        return *data;
+    }
+
+    Twitter twitter;
+    twitter.loadStopwords("../data/stopwords.txt");
+
+    std::string trainFile = "../data/twitter_training.csv";
+    std::string devFile = "../data/twitter_validation.csv";
+
+    std::pair<int, int> n_sentences = promptDatasetSize();
+    twitter.loadTrainData(trainFile, n_sentences.first);
+    twitter.loadDevData(devFile, n_sentences.second);
+
+    Dataset& trainData = twitter.getTrainData();
+    Dataset& devData = twitter.getDevData();
+
+    std::pair<int, int> limits = promptVocabularyLimits();
+    data = std::make_unique<TrainingData>();
+    data->vocabulary = Vocabulary(trainData, limits.first, limits.second);
+    data->trainMatrix = trainData.toCsr(data->vocabulary);
+    data->devMatrix = devData.toCsr(data->vocabulary);
+    data->stopwordsHash = ModelBundle::stopwordsHash("../data/stopwords.txt");
+    std::cout << "Vocabulary size: " << data->vocabulary.size() << std::endl;
+    return *data;
+}
+
+void trainNaiveBayes(std::unique_ptr<TrainingData>& data) {
     NaiveBayes nb;
+
+    std::string option = promptSaveLoadModel();
+    if (option == "1") {
+        if (nb.loadWeights("../saved_models/nb_model.bin", ModelBundle::stopwordsHash("../data/stopwords.txt"))) {
+            std::cout << "Model loaded successfully." << std::endl;
+            predictTextSentiment(nb);
+            return;
+        }
+        std::cout << "Failed to load the model. Proceeding with training." << std::endl;
+    }
+
+    const TrainingData& training = requireTrainingData(data);
     std::cout << "Training Naive Bayes..." << std::endl;
-    nb.train(trainData);
-    double accuracy = nb.evaluate(devData);
+    nb.train(training.trainMatrix, training.vocabulary);
+    double accuracy = nb.evaluate(training.devMatrix);
     std::cout << "Validation Accuracy: " << accuracy << "%" << std::endl;
 
+    std::cout << "Save the model? (yes/no): ";
+    std::string save;
+    std::cin >> save;
+    if (save == "yes") {
+        nb.saveWeights("../saved_models/nb_model.bin", training.stopwordsHash);
+    }
     predictTextSentiment(nb);
 }
 
 
-void trainLogisticRegression(Twitter& twitter, Dataset& trainData, Dataset& devData) {
-    LogisticRegression lr(trainData.createVocabulary().size());
+void trainLogisticRegression(std::unique_ptr<TrainingData>& data) {
     double learningRate = 0.01;
     int epochs = 100;
+    double regularizationParam = 0.0;
+    int numThreads = 1;
 
     std::string option = promptSaveLoadModel();
     if (option == "1") {
-        if (lr.loadWeights("../saved_models/lr_weights.bin")) {
+        LogisticRegression lr(0);
+        Vocabulary vocabulary;
+        if (lr.loadBundle("../saved_models/lr_model.bundle", ModelBundle::stopwordsHash("../data/stopwords.txt"), vocabulary)) {
             std::cout << "Model loaded successfully." << std::endl;
-        } else {
-            std::cout << "Failed to load the model. Proceeding with training." << std::endl;
+            predictTextSentiment(lr, vocabulary);
+            return;
         }
+        std::cout << "Failed to load the model. Proceeding with training." << std::endl;
+    }
+
+    const TrainingData& training = requireTrainingData(data);
+    LogisticRegression lr(training.vocabulary.size());
+
+    std::cout << "Choose solver (1 - SGD, 2 - L-BFGS): ";
+    std::string solver;
+    std::cin >> solver;
+
+    if (solver == "2") {
+        std::cout << "Set L2 regularization parameter (default 0): ";
+        std::cin >> regularizationParam;
+
+        std::cout << "Set maximum number of iterations (default 100): ";
+        std::cin >> epochs;
+
+        std::cout << "Set number of threads (0 for all cores): ";
+        std::cin >> numThreads;
+        lr.setNumThreads(numThreads);
+
+        std::cout << "Training Logistic Regression..." << std::endl;
+        lr.trainLbfgs(training.trainMatrix, training.devMatrix, regularizationParam, epochs);
     } else {
         std::cout << "Set learning rate (default 0.1): ";
         std::cin >> learningRate;
@@ -151,32 +290,72 @@ void trainLogisticRegression(Twitter& twitter, Dataset& trainData, Dataset& devD
         std::cout << "Set number of epochs (default 100): ";
         std::cin >> epochs;
 
-        std::cout << "Training Logistic Regression..." << std::endl;
-        lr.train(trainData, trainData.createVocabulary(), devData, learningRate, epochs, true);
+        std::cout << "Set L2 regularization parameter (default 0): ";
+        std::cin >> regularizationParam;
 
-        std::cout << "Save the model? (yes/no): ";
-        std::string save;
-        std::cin >> save;
-        if (save == "yes") {
-            lr.saveWeights("../saved_models/lr_weights.bin");
+        std::unique_ptr<Optimizer> optimizer = promptOptimizer();
+        bool adaptive = optimizer != nullptr;
+        lr.setOptimizer(std::move(optimizer));
+
+        // Only plain SGD runs on several threads; the adaptive optimizers keep per-feature state and train serially
+        if (!adaptive) {
+            std::cout << "Set number of threads (1 for serial SGD, 0 for all cores): ";
+            std::cin >> numThreads;
+            lr.setNumThreads(numThreads);
         }
+
+        std::cout << "Training Logistic Regression..." << std::endl;
+        lr.train(training.trainMatrix, training.devMatrix, learningRate, epochs, regularizationParam, true);
+    }
+
+    std::cout << "Save the model? (yes/no): ";
+    std::string save;
+    std::cin >> save;
+    if (save == "yes") {
+        lr.saveBundle("../saved_models/lr_model.bundle", training.vocabulary, training.stopwordsHash);
     }
-    predictTextSentiment(lr, trainData.createVocabulary());
+    predictTextSentiment(lr, training.vocabulary);
 }
 
-void trainSVM(Twitter& twitter, Dataset& trainData, Dataset& devData) {
-    SimpleSVM svm;
+void trainSVM(std::unique_ptr<TrainingData>& data) {
     double learningRate = 0.01;
     int epochs = 100;
     double regularizationParam = 0.01;
+    int numThreads = 1;
 
     std::string option = promptSaveLoadModel();
     if (option == "1") {
-        if (svm.loadWeights("../saved_models/svm_weights.bin")) {
+        SimpleSVM svm;
+        Vocabulary vocabulary;
+        if (svm.loadBundle("../saved_models/svm_model.bundle", ModelBundle::stopwordsHash("../data/stopwords.txt"), vocabulary)) {
             std::cout << "Model loaded successfully." << std::endl;
-        } else {
-            std::cout << "Failed to load the model. Proceeding with training." << std::endl;
+            predictTextSentiment(svm, vocabulary);
+            return;
         }
+        std::cout << "Failed to load the model. Proceeding with training." << std::endl;
+    }
+
+    const TrainingData& training = requireTrainingData(data);
+    SimpleSVM svm;
+
+    std::cout << "Choose solver (1 - SGD, 2 - dual coordinate descent): ";
+    std::string solver;
+    std::cin >> solver;
+
+    if (solver == "2") {
+        std::cout << "Set regularization parameter (default 0.00001): ";
+        std::cin >> regularizationParam;
+
+        std::cout << "Choose loss (1 - hinge, 2 - squared hinge): ";
+        std::string loss;
+        std::cin >> loss;
+
+        std::cout << "Set maximum number of iterations (default 100): ";
+        std::cin >> epochs;
+
+        std::cout << "Training SVM..." << std::endl;
+        svm.trainDual(training.trainMatrix, training.devMatrix, regularizationParam,
+                      loss == "2" ? SvmLoss::SquaredHinge : SvmLoss::Hinge, epochs, 0.01, true);
     } else {
         std::cout << "Set learning rate (default 0.01): ";
         std::cin >> learningRate;
@@ -187,70 +366,140 @@ void trainSVM(Twitter& twitter, Dataset& trainData, Dataset& devData) {
         std::cout << "Set regularization parameter (default 0.00001): ";
         std::cin >> regularizationParam;
 
-        std::cout << "Training SVM..." << std::endl;
-        svm.train(trainData, trainData.createVocabulary(), devData, learningRate, epochs, regularizationParam, true);
+        std::unique_ptr<Optimizer> optimizer = promptOptimizer();
+        bool adaptive = optimizer != nullptr;
+        svm.setOptimizer(std::move(optimizer));
 
-        std::cout << "Save the model? (yes/no): ";
-        std::string save;
-        std::cin >> save;
-        if (save == "yes") {
-            svm.saveWeights("../saved_models/svm_weights.bin");
+        // Only plain SGD runs on several threads; the adaptive optimizers keep per-feature state and train serially
+        if (!adaptive) {
+            std::cout << "Set number of threads (1 for serial SGD, 0 for all cores): ";
+            std::cin >> numThreads;
+            svm.setNumThreads(numThreads);
         }
+
+        std::cout << "Training SVM..." << std::endl;
+        svm.train(training.trainMatrix, training.devMatrix, learningRate, epochs, regularizationParam, true);
+    }
+
+    std::cout << "Save the model? (yes/no): ";
+    std::string save;
+    std::cin >> save;
+    if (save == "yes") {
+        svm.saveBundle("../saved_models/svm_model.bundle", training.vocabulary, training.stopwordsHash);
     }
-    predictTextSentiment(svm, trainData.createVocabulary());
+    predictTextSentiment(svm, training.vocabulary);
 }
 
-void trainNeuralNetwork(Twitter& twitter, Dataset& trainData, Dataset& devData) {
-    int inputSize = trainData.createVocabulary().size();
+void trainNeuralNetwork(std::unique_ptr<TrainingData>& data) {
     int hiddenSize = 10;
     double learningRate = 0.01;
     int epochs = 100;
+    int batchSize = 32;
+    int numThreads = 1;
 
     std::string option = promptSaveLoadModel();
-    NeuralNetwork nn(inputSize, hiddenSize);
-
     if (option == "1") {
-        if (nn.loadWeights("../saved_models/nn_weights.bin")) {
+        NeuralNetwork nn(0, 0);
+        Vocabulary vocabulary;
+        if (nn.loadBundle("../saved_models/nn_model.bundle", ModelBundle::stopwordsHash("../data/stopwords.txt"), vocabulary)) {
             std::cout << "Model loaded successfully." << std::endl;
-        } else {
-            std::cout << "Failed to load the model. Proceeding with training." << std::endl;
+            predictTextSentiment(nn, vocabulary);
+            return;
         }
-    } else {
-        std::cout << "Set hidden layer size (default 10): ";
-        std::cin >> hiddenSize;
+        std::cout << "Failed to load the model. Proceeding with training." << std::endl;
+    }
 
-        std::cout << "Set learning rate (default 0.01): ";
-        std::cin >> learningRate;
+    const TrainingData& training = requireTrainingData(data);
 
-        std::cout << "Set number of epochs (default 100): ";
-        std::cin >> epochs;
+    std::cout << "Set hidden layer size (default 10): ";
+    std::cin >> hiddenSize;
+    NeuralNetwork nn(training.vocabulary.size(), hiddenSize);
 
-        std::cout << "Training Neural Network..." << std::endl;
-        nn.train(trainData, trainData.createVocabulary(), epochs, learningRate, devData, true);
+    std::unique_ptr<Optimizer> optimizer = promptOptimizer();
+    bool adaptive = optimizer != nullptr;
+    nn.setOptimizer(std::move(optimizer));
 
-        std::cout << "Save the model? (yes/no): ";
-        std::string save;
-        std::cin >> save;
-        if (save == "yes") {
-            nn.saveWeights("../saved_models/nn_weights.bin");
-        }
+    std::cout << "Set batch size (default 32): ";
+    std::cin >> batchSize;
+    nn.setBatchSize(batchSize);
+
+    // Gradients are averaged over the batch, so plain SGD needs a rate proportional to the batch size
+    // to take the same step per sample; the adaptive optimizers normalize their steps themselves
+    double suggestedRate = adaptive ? learningRate : learningRate * std::max(batchSize, 1);
+    std::cout << "Set learning rate (suggested " << suggestedRate << " for this optimizer and batch size): ";
+    std::cin >> learningRate;
+
+    std::cout << "Set number of epochs (default 100): ";
+    std::cin >> epochs;
+
+    std::cout << "Set number of threads (0 for all cores): ";
+    std::cin >> numThreads;
+    nn.setNumThreads(numThreads);
+
+    std::cout << "Training Neural Network..." << std::endl;
+    nn.train(training.trainMatrix, epochs, learningRate, training.devMatrix, true);
+
+    std::cout << "Save the model? (yes/no): ";
+    std::string save;
+    std::cin >> save;
+    if (save == "yes") {
+        nn.saveBundle("../saved_models/nn_model.bundle", training.vocabulary, training.stopwordsHash);
     }
-    predictTextSentiment(nn, trainData.createVocabulary());
+    predictTextSentiment(nn, training.vocabulary);
 }
 
-int main() {
-    Twitter twitter;
-    twitter.loadStopwords("../data/stopwords.txt");
+void trainFTRL(std::unique_ptr<TrainingData>& data) {
+    double alpha = 0.1;
+    double beta = 1.0;
+    double l1 = 1.0;
+    double l2 = 1.0;
+    int epochs = 3;
 
-    std::string trainFile = "../data/twitter_training.csv";
-    std::string devFile = "../data/twitter_validation.csv";
+    std::string option = promptSaveLoadModel();
+    if (option == "1") {
+        FTRLProximal ftrl(0);
+        Vocabulary vocabulary;
+        if (ftrl.loadBundle("../saved_models/ftrl_model.bundle", ModelBundle::stopwordsHash("../data/stopwords.txt"), vocabulary)) {
+            std::cout << "Model loaded successfully." << std::endl;
+            predictTextSentiment(ftrl, vocabulary);
+            return;
+        }
+        std::cout << "Failed to load the model. Proceeding with training." << std::endl;
+    }
 
-    std::pair<int, int> n_sentences = promptDatasetSize();
-    twitter.loadTrainData(trainFile, n_sentences.first);
-    twitter.loadDevData(devFile, n_sentences.second);
+    const TrainingData& training = requireTrainingData(data);
 
-    Dataset& trainData = twitter.getTrainData();
-    Dataset& devData = twitter.getDevData();
+    std::cout << "Set alpha (learning rate scale, default 0.1): ";
+    std::cin >> alpha;
+
+    std::cout << "Set beta (learning rate smoothing, default 1): ";
+    std::cin >> beta;
+
+    std::cout << "Set L1 regularization parameter (default 1): ";
+    std::cin >> l1;
+
+    std::cout << "Set L2 regularization parameter (default 1): ";
+    std::cin >> l2;
+
+    std::cout << "Set number of epochs (default 3): ";
+    std::cin >> epochs;
+
+    FTRLProximal ftrl(training.vocabulary.size(), alpha, beta, l1, l2);
+    std::cout << "Training FTRL-Proximal..." << std::endl;
+    ftrl.train(training.trainMatrix, training.devMatrix, epochs, true);
+
+    std::cout << "Save the model? (yes/no): ";
+    std::string save;
+    std::cin >> save;
+    if (save == "yes") {
+        ftrl.saveBundle("../saved_models/ftrl_model.bundle", training.vocabulary, training.stopwordsHash);
+    }
+    predictTextSentiment(ftrl, training.vocabulary);
+}
+
+int main() {
+    // The datasets are loaded when a model is first trained, not at startup
+    std::unique_ptr<TrainingData> data;
 
     while (true) {
         displayMenu();
@@ -261,16 +510,19 @@ int main() {
 
         switch (choice) {
             case 1:
-                trainNaiveBayes(twitter, trainData, devData);
+                trainNaiveBayes(data);
                 break;
             case 2:
-                trainLogisticRegression(twitter, trainData, devData);
+                trainLogisticRegression(data);
                 break;
             case 3:
-                trainSVM(twitter, trainData, devData);
+                trainSVM(data);
                 break;
             case 4:
-                trainNeuralNetwork(twitter, trainData, devData);
+                trainNeuralNetwork(data);
+                break;
+            case 5:
+                trainFTRL(data);
                 break;
             case 0:
                 std::cout << "Exiting..." << std::endl;